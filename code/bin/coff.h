@@ -46,4 +46,53 @@ struct scnhdr {
         unsigned short  s_nlnno;        /* number of gp histogram entries */
         long            s_flags;        /* flags */
       };
+
+/* The symbolic header, at f_symptr, and the external symbols it points
+ * to (cf. <sym.h> and <symconst.h>); just what Nachos needs.
+ */
+
+typedef struct symhdr {
+        short   magic;          /* see below                            */
+        short   vstamp;         /* version stamp                        */
+        long    ilineMax;       /* number of line number entries        */
+        long    cbLine;         /* size of the line number table        */
+        long    cbLineOffset;   /* file ptr to it                       */
+        long    idnMax;         /* max index into dense numbers         */
+        long    cbDnOffset;     /* file ptr to them                     */
+        long    ipdMax;         /* number of procedure descriptors      */
+        long    cbPdOffset;     /* file ptr to them                     */
+        long    isymMax;        /* number of local symbols              */
+        long    cbSymOffset;    /* file ptr to them                     */
+        long    ioptMax;        /* max index into optimization entries  */
+        long    cbOptOffset;    /* file ptr to them                     */
+        long    iauxMax;        /* number of auxiliary symbols          */
+        long    cbAuxOffset;    /* file ptr to them                     */
+        long    issMax;         /* size of the local string table       */
+        long    cbSsOffset;     /* file ptr to it                       */
+        long    issExtMax;      /* size of the external string table    */
+        long    cbSsExtOffset;  /* file ptr to it                       */
+        long    ifdMax;         /* number of file descriptors           */
+        long    cbFdOffset;     /* file ptr to them                     */
+        long    crfd;           /* number of relative file descriptors  */
+        long    cbRfdOffset;    /* file ptr to them                     */
+        long    iextMax;        /* number of external symbols           */
+        long    cbExtOffset;    /* file ptr to them                     */
+      } HDRR;
+
+#define SYMHMAGIC       0x7009
+
+typedef struct extr {
+        short   reserved;
+        short   ifd;            /* file descriptor the symbol is from   */
+        long    iss;            /* index of its name in the strings     */
+        long    value;          /* its address                          */
+        long    bits;           /* st:6, sc:5, reserved:1, index:20,    */
+                                /* from the low order bit up            */
+      } EXTR;
+
+#define EXTR_ST(bits)   ((bits) & 0x3f)         /* symbol type          */
+#define EXTR_SC(bits)   (((bits) >> 6) & 0x1f)  /* storage class        */
+
+#define stProc          6       /* a procedure                          */
+#define scText          1       /* in .text                             */
  
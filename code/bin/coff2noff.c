@@ -15,6 +15,12 @@
  *	.data	-- initialized data
  *	.bss/.sbss -- uninitialized data (should be zero'd on program startup)
  *
+ * Normally the segments are packed one after the other, right after the
+ * NOFF header.  With -a, each segment is put NOFFALIGNMENT bytes into the
+ * file past its virtual address instead, with zeros in between, and the
+ * file is padded with zeros to a multiple of NOFFALIGNMENT; Nachos then
+ * reads each page of the program in with a single aligned read.
+ *
  * Copyright (c) 1992-1993 The Regents of the University of California.
  * All rights reserved.  See copyright.h for copyright notice and limitation 
  * of liability and disclaimer of warranty provisions.
@@ -98,9 +104,16 @@ main (int argc, char **argv)
     struct scnhdr *sections;
     char *buffer;
     NoffHeader noffH;
+    int aligned = 0, fileSize;
 
-    if (argc < 2) {
-	fprintf(stderr, "Usage: %s <coffFileName> <noffFileName>\n", argv[0]);
+    if (argc > 1 && !strcmp(argv[1], "-a")) {
+	aligned = 1;
+	argc--;
+	argv++;
+    }
+    if (argc < 3) {
+	fprintf(stderr, "Usage: %s [-a] <coffFileName> <noffFileName>\n",
+		argv[0]);
 	exit(1);
     }
     
@@ -154,6 +167,8 @@ main (int argc, char **argv)
   * in the COFF file
   */
     noffH.noffMagic = NOFFMAGIC;
+    if (aligned)
+	noffH.noffMagic |= NOFFALIGNED;
     noffH.code.size = 0;
     noffH.initData.size = 0;
     noffH.uninitData.size = 0;
@@ -169,6 +184,10 @@ main (int argc, char **argv)
 	if (sections[i].s_size == 0) {
 		/* do nothing! */	
 	} else if (!strcmp(sections[i].s_name, ".text")) {
+	    if (aligned) {
+		inNoffFile = NOFFALIGNMENT + sections[i].s_paddr;
+		lseek(fdOut, inNoffFile, 0);
+	    }
 	    noffH.code.virtualAddr = sections[i].s_paddr;
 	    noffH.code.inFileAddr = inNoffFile;
 	    noffH.code.size = sections[i].s_size;
@@ -187,6 +206,10 @@ main (int argc, char **argv)
 	        unlink(noffFileName);
 	        exit(1);
 	    }
+	    if (aligned) {
+		inNoffFile = NOFFALIGNMENT + sections[i].s_paddr;
+		lseek(fdOut, inNoffFile, 0);
+	    }
 	    noffH.initData.virtualAddr = sections[i].s_paddr;
 	    noffH.initData.inFileAddr = inNoffFile;
 	    noffH.initData.size = sections[i].s_size;
@@ -220,6 +243,16 @@ main (int argc, char **argv)
 	    exit(1);
 	}
     }
+    if (aligned) {
+	/* pad out the last page, so that it can be read whole */
+	fileSize = lseek(fdOut, 0, 2);
+	if (fileSize % NOFFALIGNMENT != 0) {
+	    lseek(fdOut, fileSize - fileSize % NOFFALIGNMENT
+			 + NOFFALIGNMENT - 1, 0);
+	    Write(fdOut, "", 1);
+	}
+	printf("Segments aligned to %d bytes\n", NOFFALIGNMENT);
+    }
     lseek(fdOut, 0, 0);
     Write(fdOut, (char *)&noffH, sizeof(NoffHeader));
     close(fdIn);
@@ -8,6 +8,14 @@
 #define NOFFMAGIC	0xbadfad 	/* magic number denoting Nachos 
 					 * object code file 
 					 */
+#define NOFFALIGNED	0x1000000	/* or'ed into the magic number if
+					 * each byte of the segments is
+					 * NOFFALIGNMENT bytes into the file
+					 * past its virtual address, so that
+					 * a page is read in a single aligned
+					 * read (see coff2noff -a)
+					 */
+#define NOFFALIGNMENT	256		/* a page, and a disk sector */
 
 typedef struct segment {
   int virtualAddr;		/* location of segment in virt addr space */
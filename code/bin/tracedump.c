@@ -0,0 +1,130 @@
+/* tracedump.c
+ *
+ * This program prints the TRACE messages that Nachos saved with -T.
+ * Each message is formatted exactly as Nachos would have printed it
+ * without -T, oldest first.
+ *
+ * The trace file must have been written on a host with the same
+ * byte order and int size as this one.  Its format is described in
+ * threads/utility.cc (see TraceDump):
+ *	TraceMagic, the number of messages, then for each message
+ *	its format string and each argument the format converts.
+ *	Strings (including the format) are an int length followed by
+ *	that many characters; other arguments are an int.
+ *
+ * Copyright (c) 1992-1993 The Regents of the University of California.
+ * All rights reserved.  See copyright.h for copyright notice and limitation
+ * of liability and disclaimer of warranty provisions.
+ */
+
+#define MAIN
+#include "copyright.h"
+#undef MAIN
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TraceMagic	0x4e545243	/* must match threads/utility.cc */
+
+static FILE *traceFile;
+static char *traceFileName;
+
+/* Read one int from the trace file. */
+
+static int
+ReadInt()
+{
+    int value;
+
+    if (fread(&value, sizeof(int), 1, traceFile) != 1) {
+	fprintf(stderr, "%s: file is truncated\n", traceFileName);
+	exit(1);
+    }
+    return value;
+}
+
+/* Read one string from the trace file, into a buffer from malloc. */
+
+static char *
+ReadString()
+{
+    int length = ReadInt();
+    char *string = (char *) malloc(length + 1);
+
+    if (string == NULL || fread(string, 1, length, traceFile) != length) {
+	fprintf(stderr, "%s: file is truncated\n", traceFileName);
+	exit(1);
+    }
+    string[length] = '\0';
+    return string;
+}
+
+/* Print one message, reading the arguments its format converts as
+ * they are reached.  Each conversion is handed to printf by itself.
+ */
+
+static void
+PrintMessage(char *format)
+{
+    char spec[32], *p, *start, *string;
+    int length;
+
+    for (p = format; *p != '\0'; p++) {
+	if (*p != '%') {
+	    putchar(*p);
+	    continue;
+	}
+	start = p;
+	for (p++; *p != '\0' && strchr("-+ #0123456789.hl", *p) != NULL; p++)
+	    ;
+	if (*p == '\0')
+	    break;
+	if (*p == '%') {
+	    putchar('%');
+	    continue;
+	}
+	length = p - start + 1;
+	if (length >= sizeof(spec)) {
+	    fprintf(stderr, "%s: bad format \"%s\"\n", traceFileName, format);
+	    exit(1);
+	}
+	strncpy(spec, start, length);
+	spec[length] = '\0';
+	if (*p == 's') {
+	    string = ReadString();
+	    printf(spec, string);
+	    free(string);
+	} else
+	    printf(spec, ReadInt());
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+    int count, i;
+    char *format;
+
+    if (argc != 2) {
+	fprintf(stderr, "Usage: %s <trace file>\n", argv[0]);
+	exit(1);
+    }
+    traceFileName = argv[1];
+    if ((traceFile = fopen(traceFileName, "rb")) == NULL) {
+	perror(traceFileName);
+	exit(1);
+    }
+    if (ReadInt() != TraceMagic) {
+	fprintf(stderr, "%s: not a Nachos trace file\n", traceFileName);
+	exit(1);
+    }
+    count = ReadInt();
+    for (i = 0; i < count; i++) {
+	format = ReadString();
+	PrintMessage(format);
+	free(format);
+    }
+    fclose(traceFile);
+    return 0;
+}
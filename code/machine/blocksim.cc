@@ -0,0 +1,751 @@
+// blocksim.cc -- run user code as threaded code over basic blocks
+//
+//   An alternative to fetching, decoding and switching on one
+//   instruction at a time.  The first time a basic block is reached,
+//   its instructions are turned into an array of ThreadedOps, each
+//   holding the address of the code that executes it; the block is
+//   then run by jumping from one op straight to the next (GCC's
+//   "labels as values").  Blocks are keyed by physical address and
+//   never cross a page, so one translation of the PC covers a whole
+//   block, and replacing or writing into a frame throws its blocks away.
+//
+//   The simulated machine is not allowed to notice the difference:
+//   every instruction still retires on its own, delayed loads are
+//   applied exactly where OneInstruction applies them, and the clock
+//   still advances once per instruction -- though until the next
+//   interrupt is due, that is just a matter of adding UserTick, and
+//   Interrupt::OneTick is only called at the deadline.  Whenever anything outside the
+//   block might have changed -- an exception, a context switch during
+//   an interrupt, a store into translated code -- the block is left
+//   and Machine::Run starts over from the register set.
+//
+//   Instructions that are rare or can trap in complicated ways are run
+//   by ExecuteInstruction, the same code OneInstruction uses.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#include "machine.h"
+#include "mipssim.h"
+#include "blocksim.h"
+#include "system.h"
+
+// Handlers that run two instructions back to back; numbered after the
+// real opcodes, so they can share the handler table.
+
+#define FusedLuiOri	(MaxOpcode + 1)	// lui rX,hi; ori rY,rX,lo
+#define FusedLuiAddiu	(MaxOpcode + 2)	// lui rX,hi; addiu rY,rX,lo
+#define EndOfBlock	(MaxOpcode + 3)	// leave (or chain out of) a block
+#define SlowPath	(MaxOpcode + 4)	// let ExecuteInstruction do it
+#define NumHandlers	(MaxOpcode + 5)
+
+//----------------------------------------------------------------------
+// IsControl
+// 	Return TRUE if "opCode" may change the flow of control, so that
+//	the instruction after it is a delay slot that ends the block.
+//----------------------------------------------------------------------
+
+bool
+IsControl(int opCode)
+{
+    switch (opCode) {
+      case OP_BEQ: case OP_BNE: case OP_BGEZ: case OP_BGEZAL:
+      case OP_BGTZ: case OP_BLEZ: case OP_BLTZ: case OP_BLTZAL:
+      case OP_J: case OP_JAL: case OP_JR: case OP_JALR:
+	return TRUE;
+      default:
+	return FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// IsLoad
+// 	Return TRUE if "opCode" leaves a delayed load pending.
+//----------------------------------------------------------------------
+
+bool
+IsLoad(int opCode)
+{
+    switch (opCode) {
+      case OP_LB: case OP_LBU: case OP_LH: case OP_LHU:
+      case OP_LW: case OP_LWL: case OP_LWR:
+	return TRUE;
+      default:
+	return FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::TranslateBlock
+// 	Build the threaded code for the block starting at physical
+//	address "physAddr", and remember it so the next entry at the
+//	same address can reuse it.
+//
+//	"physAddr" -- where the block starts in mainMemory
+//	"handlers" -- RunBlock's code address for each opcode
+//----------------------------------------------------------------------
+
+TranslatedBlock *
+Machine::TranslateBlock(int physAddr, void **handlers)
+{
+    ThreadedOp ops[PageSize / 4 + 1];
+    int frame = physAddr / PageSize;
+    int endAddr = (frame + 1) * PageSize;
+    int n = 0;
+    bool afterLoad = TRUE;	// we don't know what the caller left behind
+    bool inDelaySlot = FALSE;
+
+    for (int addr = physAddr; addr < endAddr; addr += 4) {
+	Instruction *instr = DecodedWord(addr);
+	int opCode = instr->opCode;
+
+	ops[n].instr = *instr;
+	ops[n].afterLoad = afterLoad;
+	switch (opCode) {
+	  case OP_ADD: case OP_ADDI: case OP_SUB:
+	  case OP_MULT: case OP_MULTU: case OP_DIV: case OP_DIVU:
+	  case OP_LWL: case OP_LWR: case OP_SWL: case OP_SWR:
+	  case OP_SYSCALL: case OP_RES: case OP_UNIMP:
+	    ops[n].handler = handlers[SlowPath];
+	    break;
+	  default:
+	    ops[n].handler = handlers[opCode];
+	    break;
+	}
+	inBlock[addr / 4] = TRUE;
+	n++;
+	afterLoad = IsLoad(opCode);
+	if (inDelaySlot || opCode == OP_SYSCALL || opCode == OP_RES
+			|| opCode == OP_UNIMP)
+	    break;
+	inDelaySlot = IsControl(opCode);
+    }
+
+    // Pair up "lui; ori" and "lui; addiu" on the same register, the
+    // way the compiler loads a 32-bit constant or address.
+    for (int i = 0; i + 1 < n; i++) {
+	Instruction *hi = &ops[i].instr, *lo = &ops[i + 1].instr;
+
+	if (hi->opCode != OP_LUI || lo->rs != hi->rt)
+	    continue;
+	if (lo->opCode == OP_ORI)
+	    ops[i].handler = handlers[FusedLuiOri];
+	else if (lo->opCode == OP_ADDIU)
+	    ops[i].handler = handlers[FusedLuiAddiu];
+	else
+	    continue;
+	i++;
+    }
+    ops[n].handler = handlers[EndOfBlock];
+
+    TranslatedBlock *block = new TranslatedBlock;
+    block->physAddr = physAddr;
+    block->numInstrs = n;
+    block->ops = new ThreadedOp[n + 1];
+    for (int i = 0; i <= n; i++)
+	block->ops[i] = ops[i];
+    block->runs = 0;
+    block->code = NULL;
+    block->virtAddr = 0;
+    block->exits = NULL;
+    block->next = frameBlocks[frame];
+    frameBlocks[frame] = block;
+    blockAt[physAddr / 4] = block;
+    return block;
+}
+
+//----------------------------------------------------------------------
+// Machine::FlushBlocks
+// 	Throw away every block translated from physical page "frame",
+//	because the page is being refilled or one of the words in it
+//	has been overwritten.
+//
+//	A block that is running right now may be among them, so the
+//	blocks are only put aside here; RunBlock frees them the next
+//	time it starts, and "blockEpoch" tells the running block to stop.
+//----------------------------------------------------------------------
+
+void
+Machine::FlushBlocks(int frame)
+{
+    TranslatedBlock *block, *next;
+
+    for (block = frameBlocks[frame]; block != NULL; block = next) {
+	next = block->next;
+	blockAt[block->physAddr / 4] = NULL;
+	block->next = deadBlocks;
+	deadBlocks = block;
+    }
+    frameBlocks[frame] = NULL;
+    for (int i = 0; i < PageSize / 4; i++)
+	inBlock[frame * PageSize / 4 + i] = FALSE;
+    blockEpoch++;
+}
+
+//----------------------------------------------------------------------
+// Machine::FreeDeadBlocks
+// 	Release the blocks put aside by FlushBlocks.
+//----------------------------------------------------------------------
+
+void
+Machine::FreeDeadBlocks()
+{
+    while (deadBlocks != NULL) {
+	TranslatedBlock *block = deadBlocks;
+
+	deadBlocks = block->next;
+	delete [] block->ops;
+	delete [] block->exits;
+	delete block;
+    }
+}
+
+// Finish an instruction the way the end of ExecuteInstruction does.
+// "afterLoad" is FALSE when the op before it in the block was not a
+// load, in which case no delayed load can be pending and only R0 needs
+// to be put back.
+
+#define RETIRE(nextReg, nextValue, pcAfter)				\
+    {									\
+	int target = (pcAfter);						\
+	if (op->afterLoad)						\
+	    registers[registers[LoadReg]] = registers[LoadValueReg];	\
+	registers[LoadReg] = (nextReg);					\
+	registers[LoadValueReg] = (nextValue);				\
+	registers[0] = 0;						\
+	registers[PrevPCReg] = registers[PCReg];			\
+	registers[PCReg] = registers[NextPCReg];			\
+	registers[NextPCReg] = target;					\
+    }
+
+// Let simulated time advance, as Machine::Run does after every
+// instruction.  Before the deadline, no interrupt can be due and no
+// profile sample is wanted, so the tick is only counted; at the
+// deadline, OneTick and ProfileTick do the real work.  If time moved
+// further than one tick, an interrupt switched to another thread, and
+// anything we know about memory may be stale.
+
+#define TICK()								\
+    {									\
+	ticks += UserTick;						\
+	if (ticks < deadline) {						\
+	    stats->totalTicks = ticks;					\
+	    stats->userTicks += UserTick;				\
+	} else {							\
+	    interrupt->OneTick();					\
+	    if (profiler != NULL)					\
+		ProfileTick();						\
+	    if (stats->totalTicks != ticks)				\
+		return;							\
+	    deadline = Deadline();					\
+	}								\
+    }
+
+// Go on to the next op of the block.
+
+#define NEXT()		{ op++; goto *op->handler; }
+
+// The instruction raised an exception, which has been handled; it
+// still takes its tick, as in Machine::Run.
+
+#define FAULT()								\
+    {									\
+	interrupt->OneTick();						\
+	if (profiler != NULL)						\
+	    ProfileTick();						\
+	return;								\
+    }
+
+//----------------------------------------------------------------------
+// Deadline
+// 	Return the time at which RunBlock has to stop just counting
+//	ticks: when the next interrupt may be due, or the next profile
+//	sample is, whichever comes first.  Until then, each instruction
+//	adds UserTick to both totalTicks and userTicks.
+//----------------------------------------------------------------------
+
+static int
+Deadline()
+{
+    int deadline = interrupt->QuietUntil();
+
+    if (profiler != NULL && profiler->rate > 0
+	    && stats->totalTicks + profiler->nextSample
+				- stats->userTicks < deadline)
+	deadline = stats->totalTicks + profiler->nextSample - stats->userTicks;
+    return deadline;
+}
+
+//----------------------------------------------------------------------
+// Machine::RunBlock
+// 	Run user instructions starting at the current PC, translating
+//	blocks as they are first reached, until something happens that
+//	needs Machine::Run's attention.  Every instruction executed is
+//	followed by a clock tick, exactly as in Machine::Run.
+//
+//	Run only calls this when NextPC == PC + 4, so the first
+//	instruction is not in a delay slot.
+//----------------------------------------------------------------------
+
+void
+Machine::RunBlock()
+{
+    static void *handlers[NumHandlers];
+    static bool handlersReady = FALSE;
+    static bool compiling;
+    TranslatedBlock *block;
+    ThreadedOp *op;
+    JitExit *exit, *lastExit = NULL;
+    int physAddr, value, tmp;
+    unsigned int vpn;
+    int epoch, ticks, deadline, budget, executed;
+    ExceptionType exception;
+
+    if (!handlersReady) {
+	for (int i = 0; i < NumHandlers; i++)
+	    handlers[i] = &&op_slow;
+	handlers[OP_ADDIU] = &&op_addiu;
+	handlers[OP_ADDU] = &&op_addu;
+	handlers[OP_AND] = &&op_and;
+	handlers[OP_ANDI] = &&op_andi;
+	handlers[OP_BEQ] = &&op_beq;
+	handlers[OP_BGEZ] = &&op_bgez;
+	handlers[OP_BGEZAL] = &&op_bgezal;
+	handlers[OP_BGTZ] = &&op_bgtz;
+	handlers[OP_BLEZ] = &&op_blez;
+	handlers[OP_BLTZ] = &&op_bltz;
+	handlers[OP_BLTZAL] = &&op_bltzal;
+	handlers[OP_BNE] = &&op_bne;
+	handlers[OP_J] = &&op_j;
+	handlers[OP_JAL] = &&op_jal;
+	handlers[OP_JALR] = &&op_jalr;
+	handlers[OP_JR] = &&op_jr;
+	handlers[OP_LB] = &&op_lb;
+	handlers[OP_LBU] = &&op_lbu;
+	handlers[OP_LH] = &&op_lh;
+	handlers[OP_LHU] = &&op_lhu;
+	handlers[OP_LUI] = &&op_lui;
+	handlers[OP_LW] = &&op_lw;
+	handlers[OP_MFHI] = &&op_mfhi;
+	handlers[OP_MFLO] = &&op_mflo;
+	handlers[OP_MTHI] = &&op_mthi;
+	handlers[OP_MTLO] = &&op_mtlo;
+	handlers[OP_NOR] = &&op_nor;
+	handlers[OP_OR] = &&op_or;
+	handlers[OP_ORI] = &&op_ori;
+	handlers[OP_SB] = &&op_sb;
+	handlers[OP_SH] = &&op_sh;
+	handlers[OP_SLL] = &&op_sll;
+	handlers[OP_SLLV] = &&op_sllv;
+	handlers[OP_SLT] = &&op_slt;
+	handlers[OP_SLTI] = &&op_slti;
+	handlers[OP_SLTIU] = &&op_sltiu;
+	handlers[OP_SLTU] = &&op_sltu;
+	handlers[OP_SRA] = &&op_sra;
+	handlers[OP_SRAV] = &&op_srav;
+	handlers[OP_SRL] = &&op_srl;
+	handlers[OP_SRLV] = &&op_srlv;
+	handlers[OP_SUBU] = &&op_subu;
+	handlers[OP_SW] = &&op_sw;
+	handlers[OP_XOR] = &&op_xor;
+	handlers[OP_XORI] = &&op_xori;
+	handlers[FusedLuiOri] = &&op_lui_ori;
+	handlers[FusedLuiAddiu] = &&op_lui_addiu;
+	handlers[EndOfBlock] = &&op_end;
+	handlersReady = TRUE;
+	compiling = (engineChoice == JitEngine) && !TraceEnabled(TraceAddr);
+    }
+    FreeDeadBlocks();
+
+    exception = Translate(registers[PCReg], &physAddr, 4, FALSE);
+    if (exception != NoException) {
+	RaiseException(exception, registers[PCReg]);
+	FAULT();
+    }
+    vpn = (unsigned) registers[PCReg] / PageSize;
+    ticks = stats->totalTicks;
+    deadline = Deadline();		// the kernel can only change
+					// it from within OneTick or
+					// an exception, and we return
+					// after either
+    epoch = blockEpoch;
+
+  enter:
+    block = blockAt[physAddr / 4];
+    if (block == NULL)
+	block = TranslateBlock(physAddr, handlers);
+    if (compiling && tlb == NULL) {
+	if (block->code == NULL && ++block->runs == JitThreshold) {
+	    lastExit = NULL;		// its code may get recycled
+	    CompileBlock(block);
+	}
+	if (block->code != NULL && block->virtAddr == registers[PCReg]) {
+	    if (lastExit != NULL && lastExit->target == physAddr)
+		ChainCompiled(lastExit, block);
+	    budget = (deadline - 1 - ticks) / UserTick;
+	    if (budget > 0) {
+		exit = RunCompiled(block, budget, &executed);
+		stats->totalTicks += executed * UserTick;
+		stats->userTicks += executed * UserTick;
+		ticks += executed * UserTick;
+		lastExit = (exit->patchSite != NULL) ? exit : NULL;
+		block = exit->block;
+		op = &block->ops[exit->index];
+		goto *op->handler;
+	    }
+	}
+	lastExit = NULL;
+    }
+    op = block->ops;
+    goto *op->handler;
+
+  op_end:
+    // The block is finished.  If execution continues in a straight line
+    // on the same page, there is no need to translate the PC again:
+    // the page is still mapped to the same frame, and its use bit is
+    // already set.
+    if (registers[NextPCReg] != registers[PCReg] + 4
+	    || (unsigned) registers[PCReg] / PageSize != vpn)
+	return;
+    physAddr = (physAddr & ~(PageSize - 1)) + registers[PCReg] % PageSize;
+    goto enter;
+
+  op_slow:
+    if (!ExecuteInstruction(&op->instr))
+	FAULT();
+    TICK();
+    if (blockEpoch != epoch)
+	return;
+    NEXT();
+
+  op_addiu:
+    registers[op->instr.rt] = registers[op->instr.rs] + op->instr.extra;
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  op_addu:
+    registers[op->instr.rd] =
+		registers[op->instr.rs] + registers[op->instr.rt];
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  op_and:
+    registers[op->instr.rd] =
+		registers[op->instr.rs] & registers[op->instr.rt];
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  op_andi:
+    registers[op->instr.rt] =
+		registers[op->instr.rs] & (op->instr.extra & 0xffff);
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  op_beq:
+    RETIRE(0, 0, registers[NextPCReg] +
+		(registers[op->instr.rs] == registers[op->instr.rt] ?
+		 IndexToAddr(op->instr.extra) : 4));
+    TICK();
+    NEXT();
+
+  op_bgezal:
+    registers[R31] = registers[NextPCReg] + 4;
+  op_bgez:
+    RETIRE(0, 0, registers[NextPCReg] +
+		(!(registers[op->instr.rs] & SIGN_BIT) ?
+		 IndexToAddr(op->instr.extra) : 4));
+    TICK();
+    NEXT();
+
+  op_bgtz:
+    RETIRE(0, 0, registers[NextPCReg] +
+		(registers[op->instr.rs] > 0 ?
+		 IndexToAddr(op->instr.extra) : 4));
+    TICK();
+    NEXT();
+
+  op_blez:
+    RETIRE(0, 0, registers[NextPCReg] +
+		(registers[op->instr.rs] <= 0 ?
+		 IndexToAddr(op->instr.extra) : 4));
+    TICK();
+    NEXT();
+
+  op_bltzal:
+    registers[R31] = registers[NextPCReg] + 4;
+  op_bltz:
+    RETIRE(0, 0, registers[NextPCReg] +
+		((registers[op->instr.rs] & SIGN_BIT) ?
+		 IndexToAddr(op->instr.extra) : 4));
+    TICK();
+    NEXT();
+
+  op_bne:
+    RETIRE(0, 0, registers[NextPCReg] +
+		(registers[op->instr.rs] != registers[op->instr.rt] ?
+		 IndexToAddr(op->instr.extra) : 4));
+    TICK();
+    NEXT();
+
+  op_jal:
+    registers[R31] = registers[NextPCReg] + 4;
+  op_j:
+    RETIRE(0, 0, ((registers[NextPCReg] + 4) & 0xf0000000) |
+		IndexToAddr(op->instr.extra));
+    TICK();
+    NEXT();
+
+  op_jalr:
+    registers[op->instr.rd] = registers[NextPCReg] + 4;
+  op_jr:
+    RETIRE(0, 0, registers[op->instr.rs]);
+    TICK();
+    NEXT();
+
+  op_lb:
+    if (!ReadMem(registers[op->instr.rs] + op->instr.extra, 1, &value))
+	FAULT();
+    if (value & 0x80)
+	value |= 0xffffff00;
+    else
+	value &= 0xff;
+    RETIRE(op->instr.rt, value, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  op_lbu:
+    if (!ReadMem(registers[op->instr.rs] + op->instr.extra, 1, &value))
+	FAULT();
+    RETIRE(op->instr.rt, value & 0xff, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  op_lh:
+  op_lhu:
+    tmp = registers[op->instr.rs] + op->instr.extra;
+    if (tmp & 0x1) {
+	RaiseException(AddressErrorException, tmp);
+	FAULT();
+    }
+    if (!ReadMem(tmp, 2, &value))
+	FAULT();
+    if ((value & 0x8000) && (op->instr.opCode == OP_LH))
+	value |= 0xffff0000;
+    else
+	value &= 0xffff;
+    RETIRE(op->instr.rt, value, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  op_lui:
+    registers[op->instr.rt] = op->instr.extra << 16;
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  op_lui_ori:
+    registers[op->instr.rt] = op->instr.extra << 16;
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    op++;
+    registers[op->instr.rt] =
+		registers[op->instr.rs] | (op->instr.extra & 0xffff);
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  op_lui_addiu:
+    registers[op->instr.rt] = op->instr.extra << 16;
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    op++;
+    registers[op->instr.rt] = registers[op->instr.rs] + op->instr.extra;
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  op_lw:
+    tmp = registers[op->instr.rs] + op->instr.extra;
+    if (tmp & 0x3) {
+	RaiseException(AddressErrorException, tmp);
+	FAULT();
+    }
+    if (!ReadMem(tmp, 4, &value))
+	FAULT();
+    RETIRE(op->instr.rt, value, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  op_mfhi:
+    registers[op->instr.rd] = registers[HiReg];
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  op_mflo:
+    registers[op->instr.rd] = registers[LoReg];
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  op_mthi:
+    registers[HiReg] = registers[op->instr.rs];
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  op_mtlo:
+    registers[LoReg] = registers[op->instr.rs];
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  op_nor:
+    registers[op->instr.rd] =
+		~(registers[op->instr.rs] | registers[op->instr.rt]);
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  op_or:
+    registers[op->instr.rd] =
+		registers[op->instr.rs] | registers[op->instr.rt];
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  op_ori:
+    registers[op->instr.rt] =
+		registers[op->instr.rs] | (op->instr.extra & 0xffff);
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  // A store may overwrite translated code, possibly this very block,
+  // so check blockEpoch once it has retired.
+
+  op_sb:
+    if (!WriteMem((unsigned) (registers[op->instr.rs] + op->instr.extra),
+		  1, registers[op->instr.rt]))
+	FAULT();
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    if (blockEpoch != epoch)
+	return;
+    NEXT();
+
+  op_sh:
+    if (!WriteMem((unsigned) (registers[op->instr.rs] + op->instr.extra),
+		  2, registers[op->instr.rt]))
+	FAULT();
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    if (blockEpoch != epoch)
+	return;
+    NEXT();
+
+  op_sw:
+    if (!WriteMem((unsigned) (registers[op->instr.rs] + op->instr.extra),
+		  4, registers[op->instr.rt]))
+	FAULT();
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    if (blockEpoch != epoch)
+	return;
+    NEXT();
+
+  op_sll:
+    registers[op->instr.rd] = registers[op->instr.rt] << op->instr.extra;
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  op_sllv:
+    registers[op->instr.rd] = registers[op->instr.rt] <<
+		(registers[op->instr.rs] & 0x1f);
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  op_slt:
+    registers[op->instr.rd] =
+		(registers[op->instr.rs] < registers[op->instr.rt]);
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  op_slti:
+    registers[op->instr.rt] = (registers[op->instr.rs] < op->instr.extra);
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  op_sltiu:
+    registers[op->instr.rt] = ((unsigned int) registers[op->instr.rs] <
+		(unsigned int) op->instr.extra);
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  op_sltu:
+    registers[op->instr.rd] = ((unsigned int) registers[op->instr.rs] <
+		(unsigned int) registers[op->instr.rt]);
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  op_sra:
+    registers[op->instr.rd] = registers[op->instr.rt] >> op->instr.extra;
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  op_srav:
+    registers[op->instr.rd] = registers[op->instr.rt] >>
+		(registers[op->instr.rs] & 0x1f);
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  op_srl:
+    registers[op->instr.rd] =
+		(int) ((unsigned int) registers[op->instr.rt] >> op->instr.extra);
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  op_srlv:
+    registers[op->instr.rd] = (int) ((unsigned int) registers[op->instr.rt]
+		>> (registers[op->instr.rs] & 0x1f));
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  op_subu:
+    registers[op->instr.rd] =
+		registers[op->instr.rs] - registers[op->instr.rt];
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  op_xor:
+    registers[op->instr.rd] =
+		registers[op->instr.rs] ^ registers[op->instr.rt];
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+
+  op_xori:
+    registers[op->instr.rt] =
+		registers[op->instr.rs] ^ (op->instr.extra & 0xffff);
+    RETIRE(0, 0, registers[NextPCReg] + 4);
+    TICK();
+    NEXT();
+}
@@ -0,0 +1,62 @@
+// blocksim.h
+//	Data structures for running user code a basic block at a time:
+//	the threaded code built by blocksim.cc, and the host machine
+//	code that jit386.cc compiles the busiest blocks into.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef BLOCKSIM_H
+#define BLOCKSIM_H
+
+#include "copyright.h"
+#include "machine.h"
+
+class TranslatedBlock;
+
+// One instruction of a translated block.
+
+class ThreadedOp {
+  public:
+    void *handler;		// code in RunBlock that executes this op
+    Instruction instr;		// the decoded instruction
+    bool afterLoad;		// a delayed load may still be pending
+				// when this op retires
+};
+
+// A place where compiled code gives control back to RunBlock: the
+// threaded code picks up again at op "index" of "block".  If the exit
+// leads straight on to another block in the same frame, "patchSite" is
+// the jump that can be pointed at that block's compiled code instead,
+// once there is some.
+
+class JitExit {
+  public:
+    TranslatedBlock *block;	// where to carry on
+    int index;			// op to carry on at
+    unsigned char *patchSite;	// jump to re-aim, or NULL
+    int target;			// physical address the jump leads to
+};
+
+// A straight-line run of instructions, ending after the delay slot of
+// the first branch or jump, at a system call or illegal instruction,
+// or at the end of the page.
+
+class TranslatedBlock {
+  public:
+    int physAddr;		// physical address of the first instruction
+    int numInstrs;		// number of instructions in the block
+    ThreadedOp *ops;		// numInstrs ops, then an EndOfBlock op
+    TranslatedBlock *next;	// next block in the same frame
+
+    int runs;			// times entered, until it gets compiled
+    unsigned char *code;	// compiled form, or NULL
+    int virtAddr;		// the PC the compiled code assumes
+    JitExit *exits;		// the compiled code's ways out
+};
+
+extern bool IsControl(int opCode);	// is the next instruction a delay slot?
+extern bool IsLoad(int opCode);		// does it leave a delayed load?
+
+#endif // BLOCKSIM_H
@@ -120,10 +120,10 @@ Disk::ReadRequest(int sectorNumber, char* data)
     ASSERT(!active);				// only one request at a time
     ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
     
-    DEBUG('d', "Reading from sector %d\n", sectorNumber);
+    TRACE(TraceDisk, "Reading from sector %d\n", sectorNumber);
     Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
     Read(fileno, data, SectorSize);
-    if (DebugIsEnabled('d'))
+    if (TraceEnabled(TraceDisk))
 	PrintSector(FALSE, sectorNumber, data);
     
     active = TRUE;
@@ -140,10 +140,10 @@ Disk::WriteRequest(int sectorNumber, char* data)
     ASSERT(!active);
     ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
     
-    DEBUG('d', "Writing to sector %d\n", sectorNumber);
+    TRACE(TraceDisk, "Writing to sector %d\n", sectorNumber);
     Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
     WriteFile(fileno, data, SectorSize);
-    if (DebugIsEnabled('d'))
+    if (TraceEnabled(TraceDisk))
 	PrintSector(TRUE, sectorNumber, data);
     
     active = TRUE;
@@ -241,14 +241,14 @@ Disk::ComputeLatency(int newSector, bool writing)
     if ((writing == FALSE) && (seek == 0) 
 		&& (((timeAfter - bufferInit) / RotationTime) 
 	     		> ModuloDiff(newSector, bufferInit / RotationTime))) {
-        DEBUG('d', "Request latency = %d\n", RotationTime);
+        TRACE(TraceDisk, "Request latency = %d\n", RotationTime);
 	return RotationTime; // time to transfer sector from the track buffer
     }
 #endif
 
     rotation += ModuloDiff(newSector, timeAfter / RotationTime) * RotationTime;
 
-    DEBUG('d', "Request latency = %d\n", seek + rotation + RotationTime);
+    TRACE(TraceDisk, "Request latency = %d\n", seek + rotation + RotationTime);
     return(seek + rotation + RotationTime);
 }
 
@@ -267,5 +267,5 @@ Disk::UpdateLast(int newSector)
     if (seek != 0)
 	bufferInit = stats->totalTicks + seek + rotate;
     lastSector = newSector;
-    DEBUG('d', "Updating last sector = %d, %d\n", lastSector, bufferInit);
+    TRACE(TraceDisk, "Updating last sector = %d, %d\n", lastSector, bufferInit);
 }
@@ -64,6 +64,7 @@ Interrupt::Interrupt()
     inHandler = FALSE;
     yieldOnReturn = FALSE;
     status = SystemMode;
+    FindNextDue();
 }
 
 //----------------------------------------------------------------------
@@ -97,7 +98,7 @@ void
 Interrupt::ChangeLevel(IntStatus old, IntStatus now)
 {
     level = now;
-    DEBUG('i',"\tinterrupts: %s -> %s\n",intLevelNames[old],intLevelNames[now]);
+    TRACE(TraceInt, "\tinterrupts: %s -> %s\n",intLevelNames[old],intLevelNames[now]);
 }
 
 //----------------------------------------------------------------------
@@ -160,7 +161,9 @@ Interrupt::OneTick()
 	stats->totalTicks += UserTick;
 	stats->userTicks += UserTick;
     }
-    DEBUG('i', "\n== Tick %d ==\n", stats->totalTicks);
+    TRACE(TraceInt, "\n== Tick %d ==\n", stats->totalTicks);
+    if (stats->totalTicks < nextDue)	// nothing can be due yet
+	return;
 
 // check any pending interrupts are now ready to fire
     ChangeLevel(IntOn, IntOff);		// first, turn off interrupts
@@ -178,6 +181,34 @@ Interrupt::OneTick()
     }
 }
 
+//----------------------------------------------------------------------
+// Interrupt::FindNextDue
+// 	Work out the earliest simulated time at which OneTick might do
+//	more than advance the clock, and save it in nextDue.  Until
+//	then, OneTick returns at once, and the machine simulation can
+//	charge a run of user instructions to the clock all at once.
+//
+//	Interrupts that are due at the same time are never skipped over:
+//	each OneTick that finds them not yet due moves the first of them
+//	behind the others, so the order they eventually fire in depends
+//	on every single tick.
+//----------------------------------------------------------------------
+
+void
+Interrupt::FindNextDue()
+{
+    int when, nextWhen = -1;
+
+    if (TraceEnabled(TraceInt))		// every tick gets printed
+	nextDue = 0;
+    else if (pending->SortedPeek(&when, &nextWhen) == NULL)
+	nextDue = 0x7fffffff;		// nothing will ever happen
+    else if (nextWhen == when)
+	nextDue = 0;
+    else
+	nextDue = when;
+}
+
 //----------------------------------------------------------------------
 // Interrupt::YieldOnReturn
 // 	Called from within an interrupt handler, to cause a context switch
@@ -210,7 +241,7 @@ Interrupt::YieldOnReturn()
 void
 Interrupt::Idle()
 {
-    DEBUG('i', "Machine idling; checking for interrupts.\n");
+    TRACE(TraceInt, "Machine idling; checking for interrupts.\n");
     status = IdleMode;
     if (CheckIfDue(TRUE)) {		// check for any pending interrupts
     	while (CheckIfDue(FALSE))	// check for any other pending 
@@ -227,7 +258,7 @@ Interrupt::Idle()
     // operating, there are *always* pending interrupts, so this code
     // is not reached.  Instead, the halt must be invoked by the user program.
 
-    DEBUG('i', "Machine idle.  No interrupts to do.\n");
+    TRACE(TraceInt, "Machine idle.  No interrupts to do.\n");
     printf("No threads ready or runnable, and no pending interrupts.\n");
     printf("Assuming the program completed.\n");
     Halt();
@@ -242,6 +273,10 @@ Interrupt::Halt()
 {
     printf("Machine halting!\n\n");
     stats->Print();
+#ifdef USER_PROGRAM
+    if (profiler != NULL)
+	profiler->Print();
+#endif
     Cleanup();     // Never returns.
 }
 
@@ -267,11 +302,12 @@ Interrupt::Schedule(VoidFunctionPtr handler, int arg, int fromNow, IntType type)
     int when = stats->totalTicks + fromNow;
     PendingInterrupt *toOccur = new PendingInterrupt(handler, arg, when, type);
 
-    DEBUG('i', "Scheduling interrupt handler the %s at time = %d\n", 
+    TRACE(TraceInt, "Scheduling interrupt handler the %s at time = %d\n", 
 					intTypeNames[type], when);
     ASSERT(fromNow > 0);
 
     pending->SortedInsert(toOccur, when);
+    FindNextDue();
 }
 
 //----------------------------------------------------------------------
@@ -295,11 +331,12 @@ Interrupt::CheckIfDue(bool advanceClock)
 
     ASSERT(level == IntOff);		// interrupts need to be disabled,
 					// to invoke an interrupt handler
-    if (DebugIsEnabled('i'))
+    if (TraceEnabled(TraceInt))
 	DumpState();
     PendingInterrupt *toOccur = 
 		(PendingInterrupt *)pending->SortedRemove(&when);
 
+    FindNextDue();
     if (toOccur == NULL)		// no pending interrupts
 	return FALSE;			
 
@@ -308,6 +345,7 @@ Interrupt::CheckIfDue(bool advanceClock)
 	stats->totalTicks = when;
     } else if (when > stats->totalTicks) {	// not time yet, put it back
 	pending->SortedInsert(toOccur, when);
+	FindNextDue();
 	return FALSE;
     }
 
@@ -315,10 +353,11 @@ Interrupt::CheckIfDue(bool advanceClock)
     if ((status == IdleMode) && (toOccur->type == TimerInt) 
 				&& pending->IsEmpty()) {
 	 pending->SortedInsert(toOccur, when);
+	 FindNextDue();
 	 return FALSE;
     }
 
-    DEBUG('i', "Invoking interrupt handler for the %s at time %d\n", 
+    TRACE(TraceInt, "Invoking interrupt handler for the %s at time %d\n", 
 			intTypeNames[toOccur->type], toOccur->when);
 #ifdef USER_PROGRAM
     if (machine != NULL)
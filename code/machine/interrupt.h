@@ -112,6 +112,9 @@ class Interrupt {
     
     void OneTick();       		// Advance simulated time
 
+    int QuietUntil() { return nextDue; } // Time before which OneTick 
+					// will only advance the clock
+
   private:
     IntStatus level;		// are interrupts enabled or disabled?
     List *pending;		// the list of interrupts scheduled
@@ -120,6 +123,8 @@ class Interrupt {
     bool yieldOnReturn; 	// TRUE if we are to context switch
 				// on return from the interrupt handler
     MachineStatus status;	// idle, kernel mode, user mode
+    int nextDue;		// when the first pending interrupt is 
+				// due, or 0 if every tick must check
 
     // these functions are internal to the interrupt simulation code
 
@@ -128,6 +133,9 @@ class Interrupt {
 
     void ChangeLevel(IntStatus old, 	// SetLevel, without advancing the
 	IntStatus now);  		// simulated time
+
+    void FindNextDue();			// recompute nextDue, whenever the
+					// pending list changes
 };
 
 #endif // INTERRRUPT_H
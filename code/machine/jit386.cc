@@ -0,0 +1,836 @@
+// jit386.cc -- compile busy basic blocks into host machine code
+//
+//   The third way of running user code ("-I 2").  Blocks are first run
+//   as threaded code by RunBlock, which counts how often each one is
+//   entered; a block entered JitThreshold times is compiled into i386
+//   instructions that do the block's work directly on the register
+//   array, and from then on RunBlock calls the compiled code instead.
+//
+//   Compiled code never calls out.  Anything it cannot finish on its
+//   own -- a page that is not mapped, a store into translated code, an
+//   overflow trap, an instruction it does not compile, or running out
+//   of time before the next interrupt -- makes it return the place
+//   where it stopped, and RunBlock carries on from there as threaded
+//   code, which deals with the problem the usual way.  So the kernel
+//   only ever sees the machine as OneInstruction would have left it.
+//
+//   Time is handled with a budget: before calling compiled code,
+//   RunBlock works out how many instructions can run before
+//   Interrupt::OneTick would have anything to do, and a compiled block
+//   only starts if all of its instructions fit.  Afterwards, RunBlock
+//   charges the instructions that ran to the clock in one go.
+//
+//   A block whose branch stays in the same frame can jump straight to
+//   the compiled code of the block it leads to: the exit is patched
+//   the first time RunBlock sees it taken to a compiled block.  Blocks
+//   in a frame are flushed together, so these jumps never outlive
+//   their target.
+//
+//   The registers of the simulated machine stay in memory; there are
+//   too few i386 registers to keep them in, so one host register holds
+//   the address of the register array instead.  The code only uses
+//   32-bit operations and addresses and makes no calls, so it also
+//   runs unchanged on an x86-64 host, provided Nachos's data lies in
+//   the low 4GB of the address space.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#include "machine.h"
+#include "mipssim.h"
+#include "blocksim.h"
+#include "system.h"
+
+#ifdef HOST_i386
+
+#define CodeSpaceSize	(1024 * 1024)	// bytes of compiled code kept
+#define MaxBlockCode	(16 * 1024)	// room needed to compile one block
+
+// i386 registers, and the condition codes we use
+
+#define EAX	0
+#define ECX	1
+#define EDX	2
+#define EBX	3
+#define EBP	5
+
+#define CondB	0x2
+#define CondAE	0x3
+#define CondE	0x4
+#define CondNE	0x5
+#define CondL	0xc
+#define CondGE	0xd
+#define CondLE	0xe
+#define CondG	0xf
+
+static unsigned char *codeSpace = NULL;	// where compiled code lives
+static int codeUsed;			// bytes of it handed out so far
+static unsigned char *enterStub;	// called to run a compiled block
+static unsigned char *leaveStub;	// where compiled code returns from
+static unsigned char *jitTarget;	// block for enterStub to jump to
+static int jitBudget;			// instructions left before the
+					// next interrupt might be due
+static int pageShift;			// log2(PageSize)
+
+static unsigned char *out;		// next byte of code to write
+
+//----------------------------------------------------------------------
+// Emitting i386 instructions.  Operands in the register array are
+// addressed relative to EBP, which points at machine->registers.
+//----------------------------------------------------------------------
+
+static void
+Byte(int b)
+{
+    *out++ = (unsigned char) b;
+}
+
+static void
+Word(int w)
+{
+    *out++ = (unsigned char) w;
+    *out++ = (unsigned char) (w >> 8);
+    *out++ = (unsigned char) (w >> 16);
+    *out++ = (unsigned char) (w >> 24);
+}
+
+static int
+Addr(void *p)
+{
+    return (int) (long) p;
+}
+
+// The operand registers[mipsReg], for a ModRM byte with "reg" in it.
+static void
+RegOperand(int reg, int mipsReg)
+{
+    if (mipsReg * 4 < 128) {
+	Byte(0x45 | (reg << 3));
+	Byte(mipsReg * 4);
+    } else {
+	Byte(0x85 | (reg << 3));
+	Word(mipsReg * 4);
+    }
+}
+
+// The operand at absolute address "p".
+static void
+AbsOperand(int reg, void *p)
+{
+    Byte(0x04 | (reg << 3));
+    Byte(0x25);
+    Word(Addr(p));
+}
+
+// The operand at "disp" plus host register "base".
+static void
+BaseOperand(int reg, int base, int disp)
+{
+    Byte(0x80 | (reg << 3) | base);
+    Word(disp);
+}
+
+// host = registers[mipsReg]
+static void
+LoadMips(int host, int mipsReg)
+{
+    Byte(0x8b);
+    RegOperand(host, mipsReg);
+}
+
+// registers[mipsReg] = host, unless that is R0
+static void
+StoreMips(int mipsReg, int host)
+{
+    if (mipsReg == 0)
+	return;
+    Byte(0x89);
+    RegOperand(host, mipsReg);
+}
+
+// registers[reg] = value; "reg" is never written if it is R0
+static void
+SetMips(int reg, int value)
+{
+    if (reg == 0)
+	return;
+    Byte(0xc7);
+    RegOperand(0, reg);
+    Word(value);
+}
+
+// host <op>= registers[mipsReg], for op = 0x03 (add), 0x0b (or),
+// 0x23 (and), 0x2b (sub), 0x33 (xor), 0x3b (cmp)
+static void
+AluMips(int op, int host, int mipsReg)
+{
+    Byte(op);
+    RegOperand(host, mipsReg);
+}
+
+// host <op>= value, for op = 0 (add), 1 (or), 4 (and), 5 (sub), 6 (xor),
+// 7 (cmp)
+static void
+AluImm(int op, int host, int value)
+{
+    Byte(0x81);
+    Byte(0xc0 | (op << 3) | host);
+    Word(value);
+}
+
+// host = (host <cond> ...) ? 1 : 0, after a compare
+static void
+SetCond(int cond, int host)
+{
+    Byte(0x0f);
+    Byte(0x90 | cond);
+    Byte(0xc0 | host);
+    Byte(0x0f);
+    Byte(0xb6);
+    Byte(0xc0 | (host << 3) | host);
+}
+
+// A short forward jump; returns the byte to fill in with FixShort
+static unsigned char *
+ShortJump(int cond)
+{
+    if (cond < 0)
+	Byte(0xeb);
+    else
+	Byte(0x70 | cond);
+    Byte(0);
+    return out - 1;
+}
+
+static void
+FixShort(unsigned char *site)
+{
+    *site = (unsigned char) (out - (site + 1));
+}
+
+// A long jump; returns the 32-bit field to fill in with FixLong
+static unsigned char *
+LongJump(int cond)
+{
+    if (cond < 0)
+	Byte(0xe9);
+    else {
+	Byte(0x0f);
+	Byte(0x80 | cond);
+    }
+    Word(0);
+    return out - 4;
+}
+
+static void
+FixLong(unsigned char *site, unsigned char *to)
+{
+    int rel = (int) (to - (site + 4));
+
+    site[0] = (unsigned char) rel;
+    site[1] = (unsigned char) (rel >> 8);
+    site[2] = (unsigned char) (rel >> 16);
+    site[3] = (unsigned char) (rel >> 24);
+}
+
+//----------------------------------------------------------------------
+// MakeStubs
+// 	Set aside the space for compiled code, and write the code that
+//	gets in and out of it: enterStub saves the registers the host's
+//	calling convention needs kept, points EBP at the register array,
+//	and jumps to jitTarget; leaveStub undoes all that and returns
+//	whatever is in EAX.
+//----------------------------------------------------------------------
+
+static void
+MakeStubs(int *registers)
+{
+    codeSpace = (unsigned char *) AllocExecutableArray(CodeSpaceSize);
+    for (pageShift = 0; (1 << pageShift) < PageSize; pageShift++)
+	;
+    ASSERT((1 << pageShift) == PageSize);
+
+    out = codeSpace;
+    enterStub = out;
+    Byte(0x55);				// push ebp
+    Byte(0x53);				// push ebx
+    Byte(0x56);				// push esi
+    Byte(0x57);				// push edi
+    Byte(0xb8 | EBP);			// mov ebp, registers
+    Word(Addr(registers));
+    Byte(0x8b);				// mov eax, [jitTarget]
+    AbsOperand(EAX, &jitTarget);
+    Byte(0xff);				// jmp eax
+    Byte(0xe0);
+
+    leaveStub = out;
+    Byte(0x5f);				// pop edi
+    Byte(0x5e);				// pop esi
+    Byte(0x5b);				// pop ebx
+    Byte(0x5d);				// pop ebp
+    Byte(0xc3);				// ret
+    codeUsed = out - codeSpace;
+}
+
+// Exits from the block being compiled; see Machine::CompileBlock.
+
+class ExitSite {
+  public:
+    unsigned char *jump;	// jump to the exit's stub
+    int index;			// op to carry on at
+    bool patchable;		// may be re-aimed at "target"
+    int target;
+};
+
+static ExitSite exitSites[PageSize / 4 * 8];
+static int numExitSites;
+
+// Leave the block before op "index" if the condition holds
+static void
+ExitIf(int cond, int index)
+{
+    exitSites[numExitSites].jump = LongJump(cond);
+    exitSites[numExitSites].index = index;
+    exitSites[numExitSites].patchable = FALSE;
+    numExitSites++;
+}
+
+// Leave the block after its last instruction, heading for physical
+// address "target" in the same frame (if "patchable").
+static void
+ExitTo(int index, bool patchable, int target)
+{
+    exitSites[numExitSites].jump = LongJump(-1);
+    exitSites[numExitSites].index = index;
+    exitSites[numExitSites].patchable = patchable;
+    exitSites[numExitSites].target = target;
+    numExitSites++;
+}
+
+//----------------------------------------------------------------------
+// Machine::CompileInstruction
+// 	Emit the code for op "k" of "block", or return FALSE if it is
+//	not an instruction we compile.
+//
+//	The instruction's effect comes first, then the delayed load left
+//	by the op before it is applied, then the delayed load this op
+//	leaves (if any) is recorded, just as in ExecuteInstruction.  The
+//	program counters are not kept up to date; whoever leaves the
+//	block sets them.
+//----------------------------------------------------------------------
+
+bool
+Machine::CompileInstruction(TranslatedBlock *block, int k)
+{
+    Instruction *instr = &block->ops[k].instr;
+    int pc = block->virtAddr + 4 * k;
+    int opCode = instr->opCode;
+    int dest = -1;		// register given the result in EAX
+    bool load = FALSE;		// the result is a delayed load instead
+    bool store = FALSE;
+    int size = 4;
+    unsigned char *skip;
+    TranslationEntry e;
+
+    switch (opCode) {
+      case OP_ADD:
+      case OP_SUB:
+	LoadMips(EAX, instr->rs);
+	AluMips(opCode == OP_ADD ? 0x03 : 0x2b, EAX, instr->rt);
+	ExitIf(0x0, k);			// jo: let ExecuteInstruction trap
+	dest = instr->rd;
+	break;
+      case OP_ADDI:
+	LoadMips(EAX, instr->rs);
+	AluImm(0, EAX, instr->extra);
+	ExitIf(0x0, k);
+	dest = instr->rt;
+	break;
+      case OP_ADDIU:
+	LoadMips(EAX, instr->rs);
+	AluImm(0, EAX, instr->extra);
+	dest = instr->rt;
+	break;
+      case OP_ADDU: case OP_SUBU: case OP_AND: case OP_OR: case OP_XOR:
+      case OP_NOR:
+	LoadMips(EAX, instr->rs);
+	AluMips(opCode == OP_ADDU ? 0x03 : opCode == OP_SUBU ? 0x2b :
+		opCode == OP_AND ? 0x23 : opCode == OP_XOR ? 0x33 : 0x0b,
+		EAX, instr->rt);
+	if (opCode == OP_NOR) {
+	    Byte(0xf7);			// not eax
+	    Byte(0xd0);
+	}
+	dest = instr->rd;
+	break;
+      case OP_ANDI: case OP_ORI: case OP_XORI:
+	LoadMips(EAX, instr->rs);
+	AluImm(opCode == OP_ANDI ? 4 : opCode == OP_ORI ? 1 : 6, EAX,
+	       instr->extra & 0xffff);
+	dest = instr->rt;
+	break;
+      case OP_LUI:
+	Byte(0xb8);			// mov eax, imm
+	Word(instr->extra << 16);
+	dest = instr->rt;
+	break;
+      case OP_SLT: case OP_SLTU:
+	LoadMips(EAX, instr->rs);
+	AluMips(0x3b, EAX, instr->rt);
+	SetCond(opCode == OP_SLT ? CondL : CondB, EAX);
+	dest = instr->rd;
+	break;
+      case OP_SLTI: case OP_SLTIU:
+	LoadMips(EAX, instr->rs);
+	AluImm(7, EAX, instr->extra);
+	SetCond(opCode == OP_SLTI ? CondL : CondB, EAX);
+	dest = instr->rt;
+	break;
+      case OP_SLL: case OP_SRL: case OP_SRA:
+	LoadMips(EAX, instr->rt);
+	Byte(0xc1);			// shl/shr/sar eax, imm
+	Byte(opCode == OP_SLL ? 0xe0 : opCode == OP_SRL ? 0xe8 : 0xf8);
+	Byte(instr->extra);
+	dest = instr->rd;
+	break;
+      case OP_SLLV: case OP_SRLV: case OP_SRAV:
+	LoadMips(ECX, instr->rs);
+	LoadMips(EAX, instr->rt);
+	Byte(0xd3);			// shl/shr/sar eax, cl
+	Byte(opCode == OP_SLLV ? 0xe0 : opCode == OP_SRLV ? 0xe8 : 0xf8);
+	dest = instr->rd;
+	break;
+      case OP_MFHI: case OP_MFLO:
+	LoadMips(EAX, opCode == OP_MFHI ? HiReg : LoReg);
+	dest = instr->rd;
+	break;
+      case OP_MTHI: case OP_MTLO:
+	LoadMips(EAX, instr->rs);
+	StoreMips(opCode == OP_MTHI ? HiReg : LoReg, EAX);
+	break;
+      case OP_MULT: case OP_MULTU:
+	LoadMips(EAX, instr->rs);
+	Byte(0xf7);			// imul/mul dword [rt]
+	RegOperand(opCode == OP_MULT ? 5 : 4, instr->rt);
+	StoreMips(LoReg, EAX);
+	StoreMips(HiReg, EDX);
+	break;
+      case OP_DIV: case OP_DIVU:
+	LoadMips(ECX, instr->rt);
+	Byte(0x85);			// test ecx, ecx
+	Byte(0xc9);
+	skip = ShortJump(CondNE);
+	SetMips(LoReg, 0);
+	SetMips(HiReg, 0);
+	{
+	    unsigned char *done = ShortJump(-1);
+
+	    FixShort(skip);
+	    LoadMips(EAX, instr->rs);
+	    if (opCode == OP_DIV) {
+		Byte(0x99);		// cdq
+		Byte(0xf7);		// idiv ecx
+		Byte(0xf9);
+	    } else {
+		Byte(0x31);		// xor edx, edx
+		Byte(0xd2);
+		Byte(0xf7);		// div ecx
+		Byte(0xf1);
+	    }
+	    StoreMips(LoReg, EAX);
+	    StoreMips(HiReg, EDX);
+	    FixShort(done);
+	}
+	break;
+
+      case OP_LW: case OP_LH: case OP_LHU: case OP_LB: case OP_LBU:
+	load = TRUE;
+	size = (opCode == OP_LW) ? 4 : (opCode == OP_LB || opCode == OP_LBU)
+		? 1 : 2;
+	break;
+      case OP_SW: case OP_SH: case OP_SB:
+	store = TRUE;
+	size = (opCode == OP_SW) ? 4 : (opCode == OP_SB) ? 1 : 2;
+	break;
+
+      case OP_BEQ: case OP_BNE:
+	LoadMips(EAX, instr->rs);
+	AluMips(0x3b, EAX, instr->rt);
+	SetMips(NextPCReg, pc + 8);
+	skip = ShortJump(opCode == OP_BEQ ? CondNE : CondE);
+	SetMips(NextPCReg, pc + 4 + IndexToAddr(instr->extra));
+	FixShort(skip);
+	break;
+      case OP_BGEZAL: case OP_BLTZAL:
+	SetMips(R31, pc + 8);
+	// fall through
+      case OP_BGEZ: case OP_BGTZ: case OP_BLEZ: case OP_BLTZ:
+	Byte(0x83);			// cmp dword [rs], 0
+	RegOperand(7, instr->rs);
+	Byte(0);
+	SetMips(NextPCReg, pc + 8);
+	skip = ShortJump((opCode == OP_BGEZ || opCode == OP_BGEZAL) ? CondL :
+			 opCode == OP_BGTZ ? CondLE : opCode == OP_BLEZ ? CondG
+			 : CondGE);
+	SetMips(NextPCReg, pc + 4 + IndexToAddr(instr->extra));
+	FixShort(skip);
+	break;
+      case OP_JAL:
+	SetMips(R31, pc + 8);
+	// fall through
+      case OP_J:
+	SetMips(NextPCReg, ((pc + 8) & 0xf0000000) |
+		IndexToAddr(instr->extra));
+	break;
+      case OP_JALR:
+	SetMips(instr->rd, pc + 8);
+	// fall through
+      case OP_JR:
+	LoadMips(EAX, instr->rs);
+	StoreMips(NextPCReg, EAX);
+	break;
+
+      default:
+	return FALSE;
+    }
+
+    if (load || store) {
+	// Translate the address the way Translate does, leaving the
+	// physical address in ECX, and give up on anything unusual.
+	LoadMips(EAX, instr->rs);
+	if (instr->extra != 0)
+	    AluImm(0, EAX, instr->extra);
+	if (size > 1) {
+	    Byte(0xa8);			// test al, size - 1
+	    Byte(size - 1);
+	    ExitIf(CondNE, k);
+	}
+	Byte(0x89);			// mov edx, eax
+	Byte(0xc2);
+	Byte(0xc1);			// shr edx, pageShift
+	Byte(0xea);
+	Byte(pageShift);
+	Byte(0x3b);			// cmp edx, [pageTableSize]
+	AbsOperand(EDX, &pageTableSize);
+	ExitIf(CondAE, k);
+	Byte(0x69);			// imul edx, edx, sizeof(entry)
+	Byte(0xd2);
+	Word(sizeof(TranslationEntry));
+	Byte(0x03);			// add edx, [pageTable]
+	AbsOperand(EDX, &pageTable);
+	Byte(0x80);			// cmp byte [edx + valid], 0
+	BaseOperand(7, EDX, (char *) &e.valid - (char *) &e);
+	Byte(0);
+	ExitIf(CondE, k);
+	if (store) {
+	    Byte(0x80);			// cmp byte [edx + readOnly], 0
+	    BaseOperand(7, EDX, (char *) &e.readOnly - (char *) &e);
+	    Byte(0);
+	    ExitIf(CondNE, k);
+	}
+	Byte(0x8b);			// mov ecx, [edx + physicalPage]
+	BaseOperand(ECX, EDX, (char *) &e.physicalPage - (char *) &e);
+	AluImm(7, ECX, NumPhysPages);
+	ExitIf(CondAE, k);
+	Byte(0xc6);			// mov byte [edx + use], 1
+	BaseOperand(0, EDX, (char *) &e.use - (char *) &e);
+	Byte(TRUE);
+	if (store) {
+	    Byte(0xc6);			// mov byte [edx + dirty], 1
+	    BaseOperand(0, EDX, (char *) &e.dirty - (char *) &e);
+	    Byte(TRUE);
+	}
+	AluImm(4, EAX, PageSize - 1);
+	Byte(0xc1);			// shl ecx, pageShift
+	Byte(0xe1);
+	Byte(pageShift);
+	Byte(0x01);			// add ecx, eax
+	Byte(0xc1);
+    }
+    if (load) {
+	switch (opCode) {
+	  case OP_LW:
+	    Byte(0x8b);			// mov eax, [ecx + mainMemory]
+	    break;
+	  case OP_LH:
+	    Byte(0x0f);			// movsx eax, word [...]
+	    Byte(0xbf);
+	    break;
+	  case OP_LHU:
+	    Byte(0x0f);			// movzx eax, word [...]
+	    Byte(0xb7);
+	    break;
+	  case OP_LB:
+	    Byte(0x0f);			// movsx eax, byte [...]
+	    Byte(0xbe);
+	    break;
+	  case OP_LBU:
+	    Byte(0x0f);			// movzx eax, byte [...]
+	    Byte(0xb6);
+	    break;
+	}
+	BaseOperand(EAX, ECX, Addr(mainMemory));
+    }
+    if (store) {
+	// A store into translated code has to flush it; leave that to
+	// WriteMem.  Otherwise, forget the word's decoded form, as
+	// WriteMem does, and store.
+	Byte(0x89);			// mov edx, ecx
+	Byte(0xca);
+	Byte(0xc1);			// shr edx, 2
+	Byte(0xea);
+	Byte(2);
+	Byte(0x80);			// cmp byte [edx + inBlock], 0
+	BaseOperand(7, EDX, Addr(inBlock));
+	Byte(0);
+	ExitIf(CondNE, k);
+	Byte(0x69);			// imul edx, edx, sizeof(Instruction)
+	Byte(0xd2);
+	Word(sizeof(Instruction));
+	Byte(0xc6);			// mov byte [edx + opCode], UndecodedOp
+	BaseOperand(0, EDX, Addr(&decodeCache[0].opCode));
+	Byte(UndecodedOp);
+	LoadMips(EDX, instr->rt);
+	if (size == 2)
+	    Byte(0x66);
+	Byte(size == 1 ? 0x88 : 0x89);	// mov [ecx + mainMemory], edx/dx/dl
+	BaseOperand(EDX, ECX, Addr(mainMemory));
+    }
+
+    // The instruction is done; now retire it.
+    if (dest >= 0)
+	StoreMips(dest, EAX);
+    if (k == 0) {
+	// Whatever delayed load the caller left behind.
+	LoadMips(ECX, LoadReg);
+	LoadMips(EDX, LoadValueReg);
+	Byte(0x89);			// mov [ebp + ecx * 4], edx
+	Byte(0x54);
+	Byte(0x8d);
+	Byte(0);
+	Byte(0xc7);			// mov dword [ebp], 0
+	Byte(0x45);
+	Byte(0);
+	Word(0);
+    } else if (IsLoad(block->ops[k - 1].instr.opCode)) {
+	LoadMips(EDX, LoadValueReg);
+	StoreMips(block->ops[k - 1].instr.rt, EDX);
+    }
+    if (load) {
+	SetMips(LoadReg, instr->rt);
+	StoreMips(LoadValueReg, EAX);
+    } else if (k == 0 || IsLoad(block->ops[k - 1].instr.opCode)) {
+	SetMips(LoadReg, 0);
+	SetMips(LoadValueReg, 0);
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::CompileBlock
+// 	Compile as much of "block" as we can, from its first op up to the
+//	first one we don't handle, for running at the current PC.
+//
+//	"block" -- a block whose first instruction is at registers[PCReg]
+//----------------------------------------------------------------------
+
+void
+Machine::CompileBlock(TranslatedBlock *block)
+{
+    int n = block->numInstrs;
+    int frameBase = block->physAddr & ~(PageSize - 1);
+    int m, i;
+    unsigned char *budgetCheck;
+    unsigned char *stub[PageSize / 4 + 1];
+
+    if (codeSpace == NULL)
+	MakeStubs(registers);
+    if (codeUsed + MaxBlockCode > CodeSpaceSize)
+	ForgetCompiledCode();
+
+    block->virtAddr = registers[PCReg];
+    block->code = out = codeSpace + codeUsed;
+    numExitSites = 0;
+
+    // Make sure the whole block fits in the time we have.
+    Byte(0x81);				// sub dword [jitBudget], m
+    AbsOperand(5, &jitBudget);
+    budgetCheck = out;
+    Word(0);
+    ExitIf(CondL, 0);
+
+    for (m = 0; m < n; m++)
+	if (!CompileInstruction(block, m))
+	    break;
+    if (m == 0) {			// nothing worth compiling
+	block->code = NULL;
+	return;
+    }
+    *(int *) budgetCheck = m;
+
+    if (m == n && n >= 2 && IsControl(block->ops[n - 2].instr.opCode)) {
+	// The block ended with a branch and its delay slot: move to the
+	// branch target, and go on to the next block if we know it.
+	int opCode = block->ops[n - 2].instr.opCode;
+	int branch = block->virtAddr + 4 * (n - 2);
+	int taken = branch + 4 + IndexToAddr(block->ops[n - 2].instr.extra);
+	int next = branch + 8;
+
+	if (opCode == OP_J || opCode == OP_JAL)
+	    taken = (next & 0xf0000000) |
+		IndexToAddr(block->ops[n - 2].instr.extra);
+	LoadMips(ECX, NextPCReg);
+	StoreMips(PCReg, ECX);
+	SetMips(PrevPCReg, block->virtAddr + 4 * (n - 1));
+	Byte(0x8d);			// lea eax, [ecx + 4]
+	Byte(0x41);
+	Byte(4);
+	StoreMips(NextPCReg, EAX);
+	if (opCode == OP_JR || opCode == OP_JALR)
+	    ExitTo(n, FALSE, 0);
+	else {
+	    int takenPhys = block->physAddr + (taken - block->virtAddr);
+	    int nextPhys = block->physAddr + (next - block->virtAddr);
+	    bool takenHere = takenPhys >= frameBase
+		&& takenPhys < frameBase + PageSize;
+	    bool nextHere = nextPhys < frameBase + PageSize;
+
+	    if (opCode != OP_J && opCode != OP_JAL) {
+		unsigned char *notTaken;
+
+		AluImm(7, ECX, taken);
+		notTaken = ShortJump(CondNE);
+		ExitTo(n, takenHere, takenPhys);
+		FixShort(notTaken);
+		ExitTo(n, nextHere, nextPhys);
+	    } else
+		ExitTo(n, takenHere, takenPhys);
+	}
+    } else
+	ExitIf(-1, m);
+
+    // Now the ways out.  Leaving before op k means ops 0..k-1 are done,
+    // so the PCs are set to point at op k, and the budget gets back
+    // what was charged for the ops that never ran.
+    block->exits = new JitExit[numExitSites];
+    for (i = 0; i <= m; i++)
+	stub[i] = NULL;
+    for (i = 0; i < numExitSites; i++) {
+	ExitSite *site = &exitSites[i];
+	JitExit *exit = &block->exits[i];
+	int k = site->index;
+
+	exit->block = block;
+	exit->index = k;
+	exit->patchSite = site->patchable ? site->jump : NULL;
+	exit->target = site->target;
+	if (k == n && k == m && n >= 2
+		&& IsControl(block->ops[n - 2].instr.opCode)) {
+	    // End of block: PCs already set, the whole budget used up.
+	    FixLong(site->jump, out);
+	    Byte(0xb8);			// mov eax, exit
+	    Word(Addr(exit));
+	    FixLong(LongJump(-1), leaveStub);
+	    continue;
+	}
+	if (stub[k] != NULL) {
+	    FixLong(site->jump, stub[k]);
+	    continue;
+	}
+	stub[k] = out;
+	FixLong(site->jump, out);
+	if (k > 0) {
+	    int pc = block->virtAddr + 4 * k;
+
+	    SetMips(PrevPCReg, pc - 4);
+	    SetMips(PCReg, pc);
+	    if (!IsControl(block->ops[k - 1].instr.opCode))
+		SetMips(NextPCReg, pc + 4);
+	}
+	if (m - k > 0) {
+	    Byte(0x81);			// add dword [jitBudget], m - k
+	    AbsOperand(0, &jitBudget);
+	    Word(m - k);
+	}
+	Byte(0xb8);			// mov eax, exit
+	Word(Addr(exit));
+	FixLong(LongJump(-1), leaveStub);
+    }
+    codeUsed = out - codeSpace;
+    ASSERT(out - block->code <= MaxBlockCode);
+}
+
+//----------------------------------------------------------------------
+// Machine::RunCompiled
+// 	Run the compiled code for "block", which starts at the current
+//	PC, for at most "budget" instructions.  Returns where it stopped;
+//	"*executed" is set to the number of instructions it ran.
+//----------------------------------------------------------------------
+
+JitExit *
+Machine::RunCompiled(TranslatedBlock *block, int budget, int *executed)
+{
+    JitExit *exit;
+
+    jitTarget = block->code;
+    jitBudget = budget;
+    exit = ((JitExit *(*)()) enterStub)();
+    *executed = budget - jitBudget;
+    return exit;
+}
+
+//----------------------------------------------------------------------
+// Machine::ChainCompiled
+// 	Control just went from "exit" to the start of "block", which has
+//	been compiled: make the exit jump there directly from now on.
+//----------------------------------------------------------------------
+
+void
+Machine::ChainCompiled(JitExit *exit, TranslatedBlock *block)
+{
+    ASSERT(exit->patchSite != NULL && exit->target == block->physAddr);
+    FixLong(exit->patchSite, block->code);
+    exit->patchSite = NULL;
+}
+
+//----------------------------------------------------------------------
+// Machine::ForgetCompiledCode
+// 	The space for compiled code is full; throw all of it away, and
+//	start compiling again from scratch.
+//----------------------------------------------------------------------
+
+void
+Machine::ForgetCompiledCode()
+{
+    TranslatedBlock *block;
+
+    for (int frame = 0; frame <= NumPhysPages; frame++) {
+	block = (frame < NumPhysPages) ? frameBlocks[frame] : deadBlocks;
+	for (; block != NULL; block = block->next) {
+	    if (block->code != NULL)
+		delete [] block->exits;
+	    block->code = NULL;
+	    block->exits = NULL;
+	    block->runs = 0;
+	}
+    }
+    codeUsed = leaveStub + 5 - codeSpace;
+}
+
+#else // HOST_i386
+
+// There is no code generator for other hosts; RunBlock never asks for
+// compiled code.
+
+bool Machine::CompileInstruction(TranslatedBlock *block, int k)
+{ return FALSE; }
+void Machine::CompileBlock(TranslatedBlock *block) {}
+JitExit *Machine::RunCompiled(TranslatedBlock *block, int budget,
+			      int *executed) { return NULL; }
+void Machine::ChainCompiled(JitExit *exit, TranslatedBlock *block) {}
+void Machine::ForgetCompiledCode() {}
+
+#endif // HOST_i386
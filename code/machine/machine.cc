@@ -50,9 +50,15 @@ void CheckEndian()
 //
 //	"debug" -- if TRUE, drop into the debugger after each user instruction
 //		is executed.
+//	"tlbEntries" -- the size of the TLB, or 0 to use linear page tables
+//	"tlbAssoc" -- how many entries each set of the TLB holds; it must
+//		divide "tlbEntries", leaving a power of 2 sets.  An
+//		instruction may need both its own page and the page it
+//		loads or stores to be in the TLB at once, so a set must
+//		hold at least two entries.
 //----------------------------------------------------------------------
 
-Machine::Machine(bool debug)
+Machine::Machine(bool debug, int tlbEntries, int tlbAssoc)
 {
     int i;
 
@@ -61,15 +67,40 @@ Machine::Machine(bool debug)
     mainMemory = new char[MemorySize];
     for (i = 0; i < MemorySize; i++)
       	mainMemory[i] = 0;
-#ifdef USE_TLB
-    tlb = new TranslationEntry[TLBSize];
-    for (i = 0; i < TLBSize; i++)
-	tlb[i].valid = FALSE;
-    pageTable = NULL;
-#else	// use linear page table
-    tlb = NULL;
+    decodeCache = new Instruction[MemorySize / 4];
+    for (i = 0; i < MemorySize / 4; i++)
+	decodeCache[i].opCode = UndecodedOp;
+    blockAt = new TranslatedBlock *[MemorySize / 4];
+    inBlock = new bool[MemorySize / 4];
+    for (i = 0; i < MemorySize / 4; i++) {
+	blockAt[i] = NULL;
+	inBlock[i] = FALSE;
+    }
+    for (i = 0; i < NumPhysPages; i++)
+	frameBlocks[i] = NULL;
+    deadBlocks = NULL;
+    blockEpoch = 0;
+    FlushTranslations();
+    tlbSize = tlbEntries;
+    if (tlbSize > 0) {
+	ASSERT(tlbAssoc >= 2 && tlbSize % tlbAssoc == 0);
+	tlbWays = tlbAssoc;
+	tlbSets = tlbSize / tlbWays;
+	ASSERT((tlbSets & (tlbSets - 1)) == 0);
+	tlb = new TranslationEntry[tlbSize];
+	tlbUsed = new unsigned int[tlbSize];
+	for (i = 0; i < tlbSize; i++) {
+	    tlb[i].valid = FALSE;
+	    tlbUsed[i] = 0;
+	}
+    } else {			// use linear page table
+	tlbWays = tlbSets = 0;
+	tlb = NULL;
+	tlbUsed = NULL;
+    }
+    tlbClock = 0;
+    asid = 0;
     pageTable = NULL;
-#endif
 
     singleStep = debug;
     CheckEndian();
@@ -83,8 +114,77 @@ Machine::Machine(bool debug)
 Machine::~Machine()
 {
     delete [] mainMemory;
-    if (tlb != NULL)
+    delete [] decodeCache;
+    for (int i = 0; i < NumPhysPages; i++)
+	FlushBlocks(i);
+    FreeDeadBlocks();
+    delete [] blockAt;
+    delete [] inBlock;
+    if (tlb != NULL) {
         delete [] tlb;
+	delete [] tlbUsed;
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::InvalidateFrame
+// 	Called by the kernel whenever it (re)fills a physical page, so that
+//	instructions predecoded or translated from the page's old contents
+//	are not executed.  Writes made by user code through WriteMem invalidate
+//	the affected word themselves.
+//
+//	"frame" -- the physical page number whose contents are changing
+//----------------------------------------------------------------------
+
+void
+Machine::InvalidateFrame(int frame)
+{
+    Instruction *instr = &decodeCache[frame * (PageSize / 4)];
+
+    ASSERT((frame >= 0) && (frame < NumPhysPages));
+    for (int i = 0; i < PageSize / 4; i++)
+	instr[i].opCode = UndecodedOp;
+    FlushBlocks(frame);
+    FlushTranslations();
+}
+
+//----------------------------------------------------------------------
+// Machine::InvalidateCode
+// 	Called by the kernel after it copies data into user memory
+//	directly, rather than through WriteMem, so that the words it
+//	wrote are decoded again if they are executed.
+//
+//	"physAddr" -- where the kernel wrote, in mainMemory
+//	"size" -- how many bytes it wrote
+//----------------------------------------------------------------------
+
+void
+Machine::InvalidateCode(int physAddr, int size)
+{
+    ASSERT((physAddr >= 0) && (size >= 0) && (physAddr + size <= MemorySize));
+    for (int i = physAddr / 4; i < (physAddr + size + 3) / 4; i++) {
+	decodeCache[i].opCode = UndecodedOp;
+	if (inBlock[i])
+	    FlushBlocks(i / (PageSize / 4));
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::FlushTranslations
+// 	Called by the kernel whenever it switches page tables, or edits
+//	an entry of the current one, so that ReadMem and WriteMem stop
+//	using translations cached from the old contents.  A cached
+//	translation still sets the use and dirty bits each time it is
+//	used, so clearing those bits needs no flush.
+//----------------------------------------------------------------------
+
+void
+Machine::FlushTranslations()
+{
+    for (int i = 0; i < TranslationCacheSize; i++) {
+	translationCache[i].readPage = -1;
+	translationCache[i].writePage = -1;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -100,7 +200,7 @@ Machine::~Machine()
 void
 Machine::RaiseException(ExceptionType which, int badVAddr)
 {
-    DEBUG('m', "Exception: %s\n", exceptionNames[which]);
+    TRACE(TraceMachine, "Exception: %s\n", exceptionNames[which]);
     
 //  ASSERT(interrupt->getStatus() == UserMode);
     registers[BadVAddrReg] = badVAddr;
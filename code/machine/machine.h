@@ -34,7 +34,10 @@
 
 #define NumPhysPages    32
 #define MemorySize 	(NumPhysPages * PageSize)
-#define TLBSize		4		// if there is a TLB, make it small
+#define TLBSize		4		// if there is a TLB, make it small,
+					// unless the kernel asks otherwise
+#define TLBWays		4		// and at most this associative
+#define NumASIDs	64		// address spaces the TLB can tell apart
 
 enum ExceptionType { NoException,           // Everything ok!
 		     SyscallException,      // A program executed a system call.
@@ -91,6 +94,40 @@ class Instruction {
                      // Immediates are sign-extended.
 };
 
+// An entry in the predecoded instruction cache whose opCode is UndecodedOp
+// has not been decoded since its word of physical memory was last written.
+// Decode never produces this value.
+
+#define UndecodedOp	0
+
+// Ways Machine::Run can execute user instructions, selected with "-I".
+
+#define InterpretEngine	0	// fetch, decode and execute one at a time
+#define BlockEngine	1	// threaded code for whole basic blocks;
+				// see blocksim.cc
+#define JitEngine	2	// as BlockEngine, but busy blocks are
+				// compiled to host code; see jit386.cc
+
+#define JitThreshold	50	// entries before a block gets compiled
+
+class TranslatedBlock;
+class JitExit;
+
+// A direct-mapped cache of recent page table lookups, indexed by
+// virtual page number, that lets ReadMem and WriteMem go straight to
+// mainMemory.  A page is only cached for writing once a write to it
+// has been allowed.  See Machine::FlushTranslations.
+
+#define TranslationCacheSize	32	// a power of 2
+
+class CachedTranslation {
+  public:
+    int readPage;		// virtual page cached for reads, or -1
+    int writePage;		// the same page if writes are allowed, or -1
+    TranslationEntry *entry;	// its page table entry
+    char *page;			// where its frame is in mainMemory
+};
+
 // The following class defines the simulated host workstation hardware, as 
 // seen by user programs -- the CPU registers, main memory, etc.
 // User programs shouldn't be able to tell that they are running on our 
@@ -101,13 +138,16 @@ class Instruction {
 // If we were to implement more of the UNIX system calls, we ought to be
 // able to run Nachos on top of Nachos!
 //
-// The procedures in this class are defined in machine.cc, mipssim.cc, and
-// translate.cc.
+// The procedures in this class are defined in machine.cc, mipssim.cc,
+// blocksim.cc, jit386.cc, profile.cc, and translate.cc.
 
 class Machine {
   public:
-    Machine(bool debug);	// Initialize the simulation of the hardware
-				// for running user programs
+    Machine(bool debug, int tlbEntries, int tlbAssoc);
+				// Initialize the simulation of the hardware
+				// for running user programs, with a TLB
+				// of "tlbEntries" entries in sets of
+				// "tlbAssoc", or none if "tlbEntries" is 0
     ~Machine();			// De-allocate the data structures
 
 // Routines callable by the Nachos kernel
@@ -118,11 +158,36 @@ class Machine {
     void WriteRegister(int num, int value);
 				// store a value into a CPU register
 
+    void InvalidateFrame(int frame);
+				// the contents of physical page "frame"
+				// are being replaced; forget anything
+				// cached about them
+
+    void FlushTranslations();	// the page table, or the pointer to it,
+				// is being changed; forget any cached
+				// translations
+
+    void InvalidateCode(int physAddr, int size);
+				// the kernel wrote "size" bytes of
+				// mainMemory at "physAddr" itself; forget
+				// any instructions decoded from them
+
 
 // Routines internal to the machine simulation -- DO NOT call these 
 
-    void OneInstruction(Instruction *instr); 	
+    void OneInstruction(); 	
     				// Run one instruction of a user program.
+    Instruction *FetchInstruction();
+				// Return the decoded instruction at PC,
+				// or NULL if the fetch raised an exception
+    bool ExecuteInstruction(Instruction *instr);
+				// Execute the instruction at PC; FALSE if
+				// it raised an exception
+    void RunBlock();		// Run user code as translated blocks, until
+				// something needs Run's attention
+    void ProfileTick();		// Sample the PC, if a sample is due
+    void ProfileInstruction();	// OneInstruction, counting the instruction
+				// in the profile
     void DelayedLoad(int nextReg, int nextVal);  	
 				// Do a pending delayed load (modifying a reg)
     
@@ -179,10 +244,69 @@ class Machine {
     TranslationEntry *tlb;		// this pointer should be considered 
 					// "read-only" to Nachos kernel code
 
+// The TLB is set associative: the entries are divided into "tlbSets"
+// sets of "tlbWays" consecutive entries each, and virtual page "vpn"
+// of the address space with ASID "space" may only be loaded into the
+// set TLBSet returns.  Each time an entry is used, the hardware stamps
+// it in "tlbUsed", so that the kernel can tell which entry of a set was
+// least recently used.
+//
+// Each TLB entry is tagged with the address space identifier (ASID)
+// of its address space, and only matches when the "asid" register
+// holds the same ASID, so the kernel need not empty the TLB on every
+// context switch.
+
+    int tlbSize;			// entries in the TLB, or 0
+    int tlbWays;			// entries in each set
+    int tlbSets;			// number of sets, a power of 2
+    unsigned int *tlbUsed;		// when each entry was last used
+    unsigned int tlbClock;		// bumped on every TLB hit
+    int asid;				// the running address space's ASID
+
+    int TLBSet(unsigned int vpn, int space)
+	{ return ((vpn ^ space) & (tlbSets - 1)) * tlbWays; }
+					// the first entry of the set that
+					// can hold "vpn" of ASID "space"
+    int TLBLookup(unsigned int vpn, int space);
+					// the TLB entry holding a valid
+					// translation for "vpn" of ASID
+					// "space", or -1
+
     TranslationEntry *pageTable;
     unsigned int pageTableSize;
 
   private:
+    CachedTranslation translationCache[TranslationCacheSize];
+    char *CachedAddress(int virtAddr, int size, bool writing);
+				// where "virtAddr" is in mainMemory,
+				// or NULL if it is not cached
+
+    Instruction *decodeCache;	// predecoded form of every word of
+				// mainMemory, indexed by physical
+				// address / 4; see FetchInstruction
+    Instruction *DecodedWord(int physAddr);
+				// decodeCache entry for "physAddr",
+				// brought up to date
+
+    TranslatedBlock *TranslateBlock(int physAddr, void **handlers);
+    void FlushBlocks(int frame);	// forget the blocks in "frame"
+    void FreeDeadBlocks();	// free blocks that were forgotten
+    TranslatedBlock **blockAt;	// block starting at each word of
+				// mainMemory, or NULL
+    bool *inBlock;		// is this word part of some block?
+    TranslatedBlock *frameBlocks[NumPhysPages];
+				// all the blocks in each frame
+    TranslatedBlock *deadBlocks; // flushed, but maybe still running
+    int blockEpoch;		// bumped whenever blocks are flushed
+
+    bool CompileInstruction(TranslatedBlock *block, int k);
+    void CompileBlock(TranslatedBlock *block);
+				// compile a busy block to host code
+    JitExit *RunCompiled(TranslatedBlock *block, int budget, int *executed);
+				// run it, for at most "budget" instructions
+    void ChainCompiled(JitExit *exit, TranslatedBlock *block);
+				// make an exit jump straight to "block"
+    void ForgetCompiledCode();	// throw away all compiled code
     bool singleStep;		// drop back into the debugger after each
 				// simulated instruction
     int runUntilTime;		// drop back into the debugger when simulated
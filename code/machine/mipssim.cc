@@ -30,15 +30,30 @@ static void Mult(int a, int b, bool signedArith, int* hiPtr, int* loPtr);
 void
 Machine::Run()
 {
-    Instruction *instr = new Instruction;  // storage for decoded instruction
-
-    if(DebugIsEnabled('m'))
+    if(TraceEnabled(TraceMachine))
         printf("Starting thread \"%s\" at time %d\n",
 	       currentThread->getName(), stats->totalTicks);
     interrupt->setStatus(UserMode);
+    bool tracing = TraceEnabled(TraceMachine);
+    bool counting = (profiler != NULL && profiler->rate == 0);
     for (;;) {
-        OneInstruction(instr);
+	// The block engine only starts a block on straight-line code; right
+	// after a branch, the delay slot is run one instruction at a time.
+	// It does not fetch each instruction through the TLB, so with a
+	// TLB everything is interpreted.
+	if (engineChoice != InterpretEngine && !singleStep && !tracing
+			&& !counting && tlb == NULL
+			&& registers[NextPCReg] == registers[PCReg] + 4) {
+	    RunBlock();
+	    continue;
+	}
+	if (counting)
+	    ProfileInstruction();
+	else
+	    OneInstruction();
 	interrupt->OneTick();
+	if (profiler != NULL)
+	    ProfileTick();
 	if (singleStep && (runUntilTime <= stats->totalTicks))
 	  Debugger();
     }
@@ -67,6 +82,52 @@ TypeToReg(RegType reg, Instruction *instr)
     }
 }
 
+//----------------------------------------------------------------------
+// Machine::FetchInstruction
+// 	Fetch the instruction at the current PC, in decoded form.
+//
+//	Decoded instructions are kept in "decodeCache", one slot per word
+//	of physical memory, so an instruction in a loop is only read and
+//	decoded the first time it is executed.  The fetch is still
+//	translated every time, so page faults and the use bit behave
+//	exactly as if the word were read with ReadMem.
+//
+//	Returns NULL if the translation raised an exception.
+//----------------------------------------------------------------------
+
+Instruction *
+Machine::FetchInstruction()
+{
+    int physicalAddress;
+    ExceptionType exception;
+
+    exception = Translate(registers[PCReg], &physicalAddress, 4, FALSE);
+    if (exception != NoException) {
+	RaiseException(exception, registers[PCReg]);
+	return NULL;
+    }
+    return DecodedWord(physicalAddress);
+}
+
+//----------------------------------------------------------------------
+// Machine::DecodedWord
+// 	Return the decoded form of the word of physical memory at
+//	"physAddr", decoding it first if it has changed since it was
+//	last looked at.
+//----------------------------------------------------------------------
+
+Instruction *
+Machine::DecodedWord(int physAddr)
+{
+    Instruction *instr = &decodeCache[physAddr / 4];
+
+    if (instr->opCode == UndecodedOp) {
+	instr->value = WordToHost(*(unsigned int *) &mainMemory[physAddr]);
+	instr->Decode();
+    }
+    return instr;
+}
+
 //----------------------------------------------------------------------
 // Machine::OneInstruction
 // 	Execute one instruction from a user-level program
@@ -91,20 +152,36 @@ TypeToReg(RegType reg, Instruction *instr)
 //----------------------------------------------------------------------
 
 void
-Machine::OneInstruction(Instruction *instr)
+Machine::OneInstruction()
 {
-    int raw;
-    int nextLoadReg = 0; 	
-    int nextLoadValue = 0; 	// record delayed load operation, to apply
-				// in the future
+    Instruction *instr;
 
     // Fetch instruction 
-    if (!machine->ReadMem(registers[PCReg], 4, &raw))
+    if ((instr = FetchInstruction()) == NULL)
 	return;			// exception occurred
-    instr->value = raw;
-    instr->Decode();
+    ExecuteInstruction(instr);
+}
 
-    if (DebugIsEnabled('m')) {
+//----------------------------------------------------------------------
+// Machine::ExecuteInstruction
+// 	Execute an instruction that has already been fetched from the
+//	current PC, including any delayed load it completes and the
+//	update of the program counters.
+//
+//	Returns FALSE if the instruction raised an exception (in which
+//	case the kernel has already handled it), TRUE otherwise.
+//
+//	"instr" -- the decoded instruction at registers[PCReg]
+//----------------------------------------------------------------------
+
+bool
+Machine::ExecuteInstruction(Instruction *instr)
+{
+    int nextLoadReg = 0; 	
+    int nextLoadValue = 0; 	// record delayed load operation, to apply
+				// in the future
+
+    if (TraceEnabled(TraceMachine)) {
        struct OpString *str = &opStrings[instr->opCode];
 
        ASSERT(instr->opCode <= MaxOpcode);
@@ -127,7 +204,7 @@ Machine::OneInstruction(Instruction *instr)
 	if (!((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
 	    ((registers[instr->rs] ^ sum) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rd] = sum;
 	break;
@@ -137,7 +214,7 @@ Machine::OneInstruction(Instruction *instr)
 	if (!((registers[instr->rs] ^ instr->extra) & SIGN_BIT) &&
 	    ((instr->extra ^ sum) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rt] = sum;
 	break;
@@ -232,7 +309,7 @@ Machine::OneInstruction(Instruction *instr)
       case OP_LBU:
 	tmp = registers[instr->rs] + instr->extra;
 	if (!machine->ReadMem(tmp, 1, &value))
-	    return;
+	    return FALSE;
 
 	if ((value & 0x80) && (instr->opCode == OP_LB))
 	    value |= 0xffffff00;
@@ -247,10 +324,10 @@ Machine::OneInstruction(Instruction *instr)
 	tmp = registers[instr->rs] + instr->extra;
 	if (tmp & 0x1) {
 	    RaiseException(AddressErrorException, tmp);
-	    return;
+	    return FALSE;
 	}
 	if (!machine->ReadMem(tmp, 2, &value))
-	    return;
+	    return FALSE;
 
 	if ((value & 0x8000) && (instr->opCode == OP_LH))
 	    value |= 0xffff0000;
@@ -261,7 +338,7 @@ Machine::OneInstruction(Instruction *instr)
 	break;
       	
       case OP_LUI:
-	DEBUG('m', "Executing: LUI r%d,%d\n", instr->rt, instr->extra);
+	TRACE(TraceMachine, "Executing: LUI r%d,%d\n", instr->rt, instr->extra);
 	registers[instr->rt] = instr->extra << 16;
 	break;
 	
@@ -269,10 +346,10 @@ Machine::OneInstruction(Instruction *instr)
 	tmp = registers[instr->rs] + instr->extra;
 	if (tmp & 0x3) {
 	    RaiseException(AddressErrorException, tmp);
-	    return;
+	    return FALSE;
 	}
 	if (!machine->ReadMem(tmp, 4, &value))
-	    return;
+	    return FALSE;
 	nextLoadReg = instr->rt;
 	nextLoadValue = value;
 	break;
@@ -286,7 +363,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!machine->ReadMem(tmp, 4, &value))
-	    return;
+	    return FALSE;
 	if (registers[LoadReg] == instr->rt)
 	    nextLoadValue = registers[LoadValueReg];
 	else
@@ -317,7 +394,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!machine->ReadMem(tmp, 4, &value))
-	    return;
+	    return FALSE;
 	if (registers[LoadReg] == instr->rt)
 	    nextLoadValue = registers[LoadValueReg];
 	else
@@ -373,7 +450,7 @@ Machine::OneInstruction(Instruction *instr)
 	break;
 	
       case OP_OR:
-	registers[instr->rd] = registers[instr->rs] | registers[instr->rs];
+	registers[instr->rd] = registers[instr->rs] | registers[instr->rt];
 	break;
 	
       case OP_ORI:
@@ -383,13 +460,13 @@ Machine::OneInstruction(Instruction *instr)
       case OP_SB:
 	if (!machine->WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 1, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SH:
 	if (!machine->WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 2, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SLL:
@@ -443,15 +520,15 @@ Machine::OneInstruction(Instruction *instr)
 	break;
 	
       case OP_SRL:
-	tmp = registers[instr->rt];
-	tmp >>= instr->extra;
-	registers[instr->rd] = tmp;
+	rt = registers[instr->rt];
+	rt >>= instr->extra;
+	registers[instr->rd] = (int) rt;
 	break;
 	
       case OP_SRLV:
-	tmp = registers[instr->rt];
-	tmp >>= (registers[instr->rs] & 0x1f);
-	registers[instr->rd] = tmp;
+	rt = registers[instr->rt];
+	rt >>= (registers[instr->rs] & 0x1f);
+	registers[instr->rd] = (int) rt;
 	break;
 	
       case OP_SUB:	  
@@ -459,7 +536,7 @@ Machine::OneInstruction(Instruction *instr)
 	if (((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
 	    ((registers[instr->rs] ^ diff) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rd] = diff;
 	break;
@@ -471,7 +548,7 @@ Machine::OneInstruction(Instruction *instr)
       case OP_SW:
 	if (!machine->WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 4, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SWL:	  
@@ -482,7 +559,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!machine->ReadMem((tmp & ~0x3), 4, &value))
-	    return;
+	    return FALSE;
 	switch (tmp & 0x3) {
 	  case 0:
 	    value = registers[instr->rt];
@@ -501,7 +578,7 @@ Machine::OneInstruction(Instruction *instr)
 	    break;
 	}
 	if (!machine->WriteMem((tmp & ~0x3), 4, value))
-	    return;
+	    return FALSE;
 	break;
     	
       case OP_SWR:	  
@@ -512,7 +589,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!machine->ReadMem((tmp & ~0x3), 4, &value))
-	    return;
+	    return FALSE;
 	switch (tmp & 0x3) {
 	  case 0:
 	    value = (value & 0xffffff) | (registers[instr->rt] << 24);
@@ -528,12 +605,12 @@ Machine::OneInstruction(Instruction *instr)
 	    break;
 	}
 	if (!machine->WriteMem((tmp & ~0x3), 4, value))
-	    return;
+	    return FALSE;
 	break;
     	
       case OP_SYSCALL:
 	RaiseException(SyscallException, 0);
-	return; 
+	return FALSE; 
 	
       case OP_XOR:
 	registers[instr->rd] = registers[instr->rs] ^ registers[instr->rt];
@@ -546,7 +623,7 @@ Machine::OneInstruction(Instruction *instr)
       case OP_RES:
       case OP_UNIMP:
 	RaiseException(IllegalInstrException, 0);
-	return;
+	return FALSE;
 	
       default:
 	ASSERT(FALSE);
@@ -562,6 +639,7 @@ Machine::OneInstruction(Instruction *instr)
 						// are jumping into lala-land
     registers[PCReg] = registers[NextPCReg];
     registers[NextPCReg] = pcAfter;
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -0,0 +1,538 @@
+// profile.cc
+//	Routines to profile user programs, and to print what was found.
+//
+//	Each address space gets a Profile, counting samples (or, when
+//	counting exactly, executions) for each word of its code and for
+//	each opcode.  The report ranks the functions, loops, and basic
+//	blocks where the counts are highest, and the opcode mix.
+//
+//	Functions are found in the external symbol table of the COFF
+//	file the program's NOFF file was made from.  Loops are found by
+//	decoding the program's code and looking for backward branches;
+//	each one is taken to close a loop running from its target to its
+//	delay slot.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "profile.h"
+#include "machine.h"
+#include "mipssim.h"
+#include "blocksim.h"
+#include "system.h"
+#include "coff.h"
+
+#define ReportLines	10	// entries listed in each part of a report
+
+class Symbol {
+  public:
+    int value;			// the procedure's address
+    char *name;			// its name
+};
+
+//----------------------------------------------------------------------
+// Profile::Profile
+// 	Initialize the counts for a new program.
+//
+//	"fileName" -- the program's NOFF file
+//	"size" -- the size of its address space, in bytes
+//----------------------------------------------------------------------
+
+Profile::Profile(char *fileName, int size)
+{
+    name = new char[strlen(fileName) + 1];
+    strcpy(name, fileName);
+    numWords = divRoundUp(size, 4);
+    pcCounts = new unsigned int[numWords];
+    blockCounts = new unsigned int[numWords];
+    for (int i = 0; i < numWords; i++)
+	pcCounts[i] = blockCounts[i] = 0;
+    for (int i = 0; i < NumOpCodeCounts; i++)
+	opCounts[i] = 0;
+    total = 0;
+    wasControl = FALSE;
+    wasDelaySlot = TRUE;		// the first instruction starts a block
+    next = NULL;
+}
+
+Profile::~Profile()
+{
+    delete [] name;
+    delete [] pcCounts;
+    delete [] blockCounts;
+}
+
+//----------------------------------------------------------------------
+// Profile::Sample
+// 	Count one sample of the program's PC.
+//
+//	"pc" -- where the program was
+//	"opCode" -- the instruction there, or -1 if it is not in memory
+//----------------------------------------------------------------------
+
+void
+Profile::Sample(int pc, int opCode)
+{
+    if ((unsigned) pc / 4 < (unsigned) numWords)
+	pcCounts[pc / 4]++;
+    if (opCode >= 0)
+	opCounts[opCode]++;
+    total++;
+}
+
+//----------------------------------------------------------------------
+// Profile::Executed
+// 	Count one instruction executed, when counting exactly.  The
+//	instruction after a branch's delay slot, or after a system call,
+//	starts a new basic block.
+//
+//	"pc" -- where the instruction is
+//	"opCode" -- what it is
+//----------------------------------------------------------------------
+
+void
+Profile::Executed(int pc, int opCode)
+{
+    if ((unsigned) pc / 4 < (unsigned) numWords) {
+	pcCounts[pc / 4]++;
+	if (wasDelaySlot)
+	    blockCounts[pc / 4]++;
+    }
+    opCounts[opCode]++;
+    total++;
+    wasDelaySlot = wasControl || (opCode == OP_SYSCALL);
+    wasControl = IsControl(opCode);
+}
+
+//----------------------------------------------------------------------
+// ReadSymbols
+// 	Read the procedures in the external symbol table of a COFF file,
+//	sorted by address.
+//
+//	"fileName" -- the COFF file
+//	"symbols" -- set to the procedures found, in an array from new
+//	"names" -- set to the space their names are in, also from new
+//
+// Returns:
+//	The number of procedures found; 0 if the file can't be read.
+//----------------------------------------------------------------------
+
+static int
+ReadSymbols(char *fileName, Symbol **symbols, char **names)
+{
+    OpenFile *file = fileSystem->Open(fileName);
+    struct filehdr fileh;
+    HDRR symh;
+    EXTR *externals;
+    int numExternals, stringsSize, bits, count = 0;
+    Symbol symbol;
+
+    *symbols = NULL;
+    *names = NULL;
+    if (file == NULL)
+	return 0;
+    if (file->ReadAt((char *) &fileh, sizeof(fileh), 0) != sizeof(fileh)
+	    || ShortToHost(fileh.f_magic) != MIPSELMAGIC
+	    || file->ReadAt((char *) &symh, sizeof(symh),
+			    WordToHost(fileh.f_symptr)) != sizeof(symh)
+	    || ShortToHost(symh.magic) != SYMHMAGIC) {
+	delete file;
+	return 0;
+    }
+    stringsSize = WordToHost(symh.issExtMax);
+    numExternals = WordToHost(symh.iextMax);
+
+    *names = new char[stringsSize + 1];
+    file->ReadAt(*names, stringsSize, WordToHost(symh.cbSsExtOffset));
+    (*names)[stringsSize] = '\0';
+    externals = new EXTR[numExternals];
+    file->ReadAt((char *) externals, numExternals * sizeof(EXTR),
+		 WordToHost(symh.cbExtOffset));
+    *symbols = new Symbol[numExternals];
+    for (int i = 0; i < numExternals; i++) {
+	bits = WordToHost(externals[i].bits);
+	if (EXTR_ST(bits) != stProc || EXTR_SC(bits) != scText)
+	    continue;
+	symbol.value = WordToHost(externals[i].value);
+	symbol.name = *names + WordToHost(externals[i].iss);
+	int j;			// keep them sorted as they come in
+	for (j = count; j > 0 && (*symbols)[j - 1].value > symbol.value; j--)
+	    (*symbols)[j] = (*symbols)[j - 1];
+	(*symbols)[j] = symbol;
+	count++;
+    }
+    delete [] externals;
+    delete file;
+    return count;
+}
+
+//----------------------------------------------------------------------
+// FindSymbol
+// 	Return the index of the procedure containing "pc", or -1 if it
+//	comes before them all.
+//----------------------------------------------------------------------
+
+static int
+FindSymbol(Symbol *symbols, int numSymbols, int pc)
+{
+    int low = 0, high = numSymbols - 1, middle;
+
+    if (numSymbols == 0 || pc < symbols[0].value)
+	return -1;
+    while (low < high) {		// find the last value <= pc
+	middle = (low + high + 1) / 2;
+	if (symbols[middle].value <= pc)
+	    low = middle;
+	else
+	    high = middle - 1;
+    }
+    return low;
+}
+
+//----------------------------------------------------------------------
+// Where
+// 	Describe an address as a procedure name and offset, if possible.
+//
+//	"buffer" -- where to put the description, at least 80 characters
+//----------------------------------------------------------------------
+
+static char *
+Where(Symbol *symbols, int numSymbols, int pc, char *buffer)
+{
+    int i = FindSymbol(symbols, numSymbols, pc);
+
+    if (i < 0)
+	sprintf(buffer, "0x%x", pc);
+    else if (pc == symbols[i].value)
+	sprintf(buffer, "%.60s", symbols[i].name);
+    else
+	sprintf(buffer, "%.60s+0x%x", symbols[i].name, pc - symbols[i].value);
+    return buffer;
+}
+
+//----------------------------------------------------------------------
+// Busiest
+// 	Find the largest count not yet reported, and mark it reported.
+//
+//	"counts" -- the counts to choose from
+//	"reported" -- which ones have been reported already
+//	"n" -- how many there are
+//
+// Returns:
+//	The index of the count, or -1 if all the rest are zero.
+//----------------------------------------------------------------------
+
+static int
+Busiest(unsigned int *counts, bool *reported, int n)
+{
+    int best = -1;
+
+    for (int i = 0; i < n; i++)
+	if (!reported[i] && counts[i] > 0
+		&& (best < 0 || counts[i] > counts[best]))
+	    best = i;
+    if (best >= 0)
+	reported[best] = TRUE;
+    return best;
+}
+
+//----------------------------------------------------------------------
+// ReadCode
+// 	Read the code segment of a NOFF file.
+//
+//	"fileName" -- the NOFF file
+//	"start" -- set to the virtual address of the code
+//
+// Returns:
+//	The number of instructions read into "*code", an array from new;
+//	0 if the file can't be read.
+//----------------------------------------------------------------------
+
+static int
+ReadCode(char *fileName, int *start, unsigned int **code)
+{
+    OpenFile *file = fileSystem->Open(fileName);
+    NoffHeader noffH;
+    int numWords;
+
+    *code = NULL;
+    if (file == NULL)
+	return 0;
+    file->ReadAt((char *) &noffH, sizeof(noffH), 0);
+    if ((noffH.noffMagic & ~NOFFALIGNED) != NOFFMAGIC
+	|| noffH.code.size <= 0) {
+	delete file;
+	return 0;
+    }
+    numWords = noffH.code.size / 4;
+    *start = noffH.code.virtualAddr;
+    *code = new unsigned int[numWords];
+    file->ReadAt((char *) *code, numWords * 4, noffH.code.inFileAddr);
+    for (int i = 0; i < numWords; i++)
+	(*code)[i] = WordToHost((*code)[i]);
+    delete file;
+    return numWords;
+}
+
+//----------------------------------------------------------------------
+// Profile::Print
+// 	Print the report for this program, if anything was counted.
+//
+//	"rate" -- user instructions between samples, or 0 if everything
+//		was counted exactly
+//----------------------------------------------------------------------
+
+void
+Profile::Print(int rate)
+{
+    Symbol *symbols;
+    int numSymbols, numCode, codeStart, numLoops = 0, i, k;
+    unsigned int *code, *counts, *loopCounts;
+    int *loopHead, *loopTail;
+    bool *reported;
+    char *coffName, *names, where[80], where2[80], *what;
+    Instruction instr;
+
+    if (total == 0)
+	return;
+    coffName = new char[strlen(name) + 6];
+    sprintf(coffName, "%s.coff", name);
+    numSymbols = ReadSymbols(coffName, &symbols, &names);
+    delete [] coffName;
+    numCode = ReadCode(name, &codeStart, &code);
+    reported = new bool[max(max(numSymbols + 1, numCode), 
+			    max(numWords, NumOpCodeCounts))];
+    what = (rate == 0) ? (char *) "executed" : (char *) "samples";
+    printf("\nProfile of %s: ", name);
+    if (rate == 0)
+	printf("%u instructions, counted exactly\n", total);
+    else
+	printf("%u samples, one every %d user instructions\n", total, rate);
+
+// functions
+    counts = new unsigned int[numSymbols + 1];	// the last for "no symbol"
+    for (i = 0; i <= numSymbols; i++) {
+	counts[i] = 0;
+	reported[i] = FALSE;
+    }
+    for (i = 0; i < numWords; i++)
+	if (pcCounts[i] > 0) {
+	    k = FindSymbol(symbols, numSymbols, i * 4);
+	    counts[(k < 0) ? numSymbols : k] += pcCounts[i];
+	}
+    printf("  %10s %6s  %s\n", what, "%", "function");
+    for (int n = 0; n < ReportLines; n++) {
+	if ((k = Busiest(counts, reported, numSymbols + 1)) < 0)
+	    break;
+	printf("  %10u %6.2f  %s\n", counts[k], 100.0 * counts[k] / total,
+		(k == numSymbols) ? "(unknown)" : symbols[k].name);
+    }
+    delete [] counts;
+
+// loops: the code from a backward branch's target to its delay slot
+    loopCounts = new unsigned int[numCode];
+    loopHead = new int[numCode];
+    loopTail = new int[numCode];
+    for (i = 0; i < numCode; i++) {
+	int pc = codeStart + i * 4, target;
+
+	instr.value = code[i];
+	instr.Decode();
+	switch (instr.opCode) {
+	  case OP_BEQ: case OP_BNE: case OP_BLEZ: case OP_BGTZ:
+	  case OP_BLTZ: case OP_BGEZ: case OP_BLTZAL: case OP_BGEZAL:
+	    target = pc + 4 + IndexToAddr(instr.extra);
+	    break;
+	  case OP_J:
+	    target = ((pc + 8) & 0xf0000000) | IndexToAddr(instr.extra);
+	    break;
+	  default:
+	    continue;
+	}
+	if (target > pc || target < 0)
+	    continue;
+	loopHead[numLoops] = target;
+	loopTail[numLoops] = pc + 4;
+	loopCounts[numLoops] = 0;
+	for (k = target / 4; k <= (pc + 4) / 4 && k < numWords; k++)
+	    loopCounts[numLoops] += pcCounts[k];
+	reported[numLoops] = FALSE;
+	numLoops++;
+    }
+    if (numLoops > 0) {
+	printf("  %10s %6s  %s\n", what, "%", "loop");
+	for (int n = 0; n < ReportLines; n++) {
+	    if ((k = Busiest(loopCounts, reported, numLoops)) < 0)
+		break;
+	    printf("  %10u %6.2f  %s .. %s", loopCounts[k],
+		100.0 * loopCounts[k] / total,
+		Where(symbols, numSymbols, loopHead[k], where),
+		Where(symbols, numSymbols, loopTail[k], where2));
+	    if (rate == 0)
+		printf(", entered %u times", blockCounts[loopHead[k] / 4]);
+	    printf("\n");
+	}
+    }
+    delete [] code;
+    delete [] loopCounts;
+    delete [] loopHead;
+    delete [] loopTail;
+
+// basic blocks, when counted
+    if (rate == 0) {
+	for (i = 0; i < numWords; i++)
+	    reported[i] = FALSE;
+	printf("  %10s  %s\n", "entered", "basic block");
+	for (int n = 0; n < ReportLines; n++) {
+	    if ((k = Busiest(blockCounts, reported, numWords)) < 0)
+		break;
+	    printf("  %10u  %s\n", blockCounts[k],
+		Where(symbols, numSymbols, k * 4, where));
+	}
+    }
+
+// opcodes
+    for (i = 0; i < NumOpCodeCounts; i++)
+	reported[i] = FALSE;
+    printf("  %10s %6s  %s\n", what, "%", "opcode");
+    for (int n = 0; n < ReportLines; n++) {
+	if ((k = Busiest(opCounts, reported, NumOpCodeCounts)) < 0)
+	    break;
+	for (i = 0; opStrings[k].string[i] != ' '
+			&& opStrings[k].string[i] != '\0'; i++)
+	    where[i] = opStrings[k].string[i];
+	where[i] = '\0';
+	printf("  %10u %6.2f  %s\n", opCounts[k], 100.0 * opCounts[k] / total,
+		where);
+    }
+    delete [] reported;
+    delete [] symbols;
+    delete [] names;
+}
+
+//----------------------------------------------------------------------
+// Profiler::Profiler
+// 	Initialize the profiler.
+//
+//	"sampleRate" -- user instructions between samples of the PC; if
+//		0, every instruction is counted instead
+//----------------------------------------------------------------------
+
+Profiler::Profiler(int sampleRate)
+{
+    ASSERT(sampleRate >= 0);
+    rate = sampleRate;
+    nextSample = (rate == 0) ? 0x7fffffff : rate * UserTick;
+    first = last = NULL;
+}
+
+Profiler::~Profiler()
+{
+    Profile *profile;
+
+    while (first != NULL) {
+	profile = first;
+	first = first->next;
+	delete profile;
+    }
+}
+
+//----------------------------------------------------------------------
+// Profiler::NewProfile
+// 	Start profiling a program, whose address space has just been
+//	created.  The profile is kept after the program exits, until
+//	the report is printed.
+//
+//	"fileName" -- the program's NOFF file
+//	"size" -- the size of its address space, in bytes
+//----------------------------------------------------------------------
+
+Profile *
+Profiler::NewProfile(char *fileName, int size)
+{
+    Profile *profile = new Profile(fileName, size);
+
+    if (first == NULL)
+	first = profile;
+    else
+	last->next = profile;
+    last = profile;
+    return profile;
+}
+
+//----------------------------------------------------------------------
+// Profiler::Print
+// 	Print the report for every program profiled, in the order they
+//	were started.  Called when Nachos halts.
+//----------------------------------------------------------------------
+
+void
+Profiler::Print()
+{
+    for (Profile *profile = first; profile != NULL; profile = profile->next)
+	profile->Print(rate);
+}
+
+//----------------------------------------------------------------------
+// Machine::ProfileTick
+// 	Called by Machine::Run after each user instruction's clock tick,
+//	when profiling.  If a sample is due, count the PC (the next 
+//	instruction to run) and its opcode in the running program's
+//	profile.
+//
+//	The opcode is found without Translate, so that taking the sample
+//	does not touch the use bits, or the TLB's statistics.
+//----------------------------------------------------------------------
+
+void
+Machine::ProfileTick()
+{
+    Profile *profile;
+    TranslationEntry *entry = NULL;
+    int i, pc = registers[PCReg], opCode = -1;
+    unsigned int vpn = (unsigned) pc / PageSize;
+
+    if (stats->userTicks < profiler->nextSample)
+	return;
+    profiler->nextSample = stats->userTicks + profiler->rate * UserTick;
+    if (currentThread->space == NULL
+	    || (profile = currentThread->space->profile) == NULL)
+	return;
+    if (tlb != NULL) {
+	if ((i = TLBLookup(vpn, asid)) >= 0)
+	    entry = &tlb[i];
+    } else if (pageTable != NULL && vpn < pageTableSize)
+	entry = &pageTable[vpn];
+    if (entry != NULL && entry->valid)
+	opCode = DecodedWord(entry->physicalPage * PageSize 
+				+ pc % PageSize)->opCode;
+    profile->Sample(pc, opCode);
+}
+
+//----------------------------------------------------------------------
+// Machine::ProfileInstruction
+// 	Run one instruction, as OneInstruction does, and count it in
+//	the running program's profile.  Used by Machine::Run instead of
+//	OneInstruction when counting exactly.
+//
+//	An instruction that raises an exception is not counted, since
+//	it will be run again -- except for a system call, which the
+//	kernel finishes.
+//----------------------------------------------------------------------
+
+void
+Machine::ProfileInstruction()
+{
+    Instruction *instr = FetchInstruction();
+    Profile *profile = currentThread->space->profile;
+    int pc = registers[PCReg], opCode;
+
+    if (instr == NULL)
+	return;
+    opCode = instr->opCode;		// in case it writes over itself
+    if (ExecuteInstruction(instr) || opCode == OP_SYSCALL)
+	if (profile != NULL)
+	    profile->Executed(pc, opCode);
+}
@@ -0,0 +1,73 @@
+// profile.h
+//	Data structures for profiling user programs: where each program
+//	spends its simulated time, by instruction, function, loop and
+//	opcode.
+//
+//	With "-P n", Machine::Run samples the PC of the running program
+//	once every n user instructions.  With "-P 0", every instruction
+//	and every basic block entered is counted exactly instead, which
+//	means running the interpreter.  Interrupt::Halt prints a report
+//	for each program, naming functions from the symbol table of the
+//	program's COFF file (its NOFF file's name plus ".coff", the way
+//	test/Makefile builds them).
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "copyright.h"
+#include "utility.h"
+
+#define NumOpCodeCounts	256	// one per value of Instruction::opCode
+
+// The counts collected for one address space.
+
+class Profile {
+  public:
+    Profile(char *fileName, int size);	// profile the program in
+					// "fileName", "size" bytes big
+    ~Profile();
+
+    void Sample(int pc, int opCode);	// the program was found at "pc"
+    void Executed(int pc, int opCode);	// the program ran the instruction
+					// at "pc" (exact counting only)
+    void Print(int rate);		// print the report
+
+    Profile *next;			// next program profiled
+
+  private:
+    char *name;				// the program's NOFF file
+    int numWords;			// words in the address space
+    unsigned int *pcCounts;		// samples or executions, by word
+    unsigned int *blockCounts;		// basic blocks entered, by word
+					// (exact counting only)
+    unsigned int opCounts[NumOpCodeCounts]; // samples or executions,
+					// by opcode
+    unsigned int total;			// all samples or executions
+    bool wasControl;			// the last instruction was a branch
+    bool wasDelaySlot;			// the last instruction ended a block
+};
+
+// The profiler: the sampling rate, and every program's profile.
+
+class Profiler {
+  public:
+    Profiler(int sampleRate);		// 0 means count everything
+    ~Profiler();
+
+    Profile *NewProfile(char *fileName, int size);
+					// start profiling a new program
+    void Print();			// print all the reports
+
+    int rate;				// user instructions between samples
+    int nextSample;			// userTicks at which the next sample
+					// is due
+
+  private:
+    Profile *first, *last;		// programs profiled, oldest first
+};
+
+#endif // PROFILE_H
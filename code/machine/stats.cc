@@ -22,6 +22,40 @@ Statistics::Statistics()
     numDiskReads = numDiskWrites = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numTLBHits = numTLBMisses = numTLBRefillTicks = numTLBSwitches = 0;
+    numZeroFills = numSwapReads = numSwapWrites = numPageInWaits = 0;
+    numDirtyEvictions = numClusteredPages = 0;
+    numSwapCacheStores = numSwapCacheRejects = 0;
+    numSwapCacheBytesIn = numSwapCacheBytesOut = 0;
+    numSwapCacheHits = numSwapCacheMisses = numSwapCacheWriteBacks = 0;
+    numMergeScans = numPagesMerged = 0;
+    numForks = numForkPagesShared = numCopiesOnWrite = 0;
+    numPageCacheHits = numPageCacheFills = numPageCacheDrops = 0;
+    numCleanerWrites = numCleanerBatches = 0;
+    numFramesZeroedIdle = numZeroedFramesUsed = 0;
+    numPrefetches = numPrefetchHits = numPrefetchesWasted = 0;
+    numSuspensions = numWorkingSets = 0;
+}
+
+//----------------------------------------------------------------------
+// Statistics::RecordWorkingSet
+// 	Keep the working set statistics of a process that has exited,
+//	if there is still room for them.
+//----------------------------------------------------------------------
+
+void
+Statistics::RecordWorkingSet(int id, int meanPages, int peakPages,
+			     int suspensions)
+{
+    WorkingSetStats *ws;
+
+    if (numWorkingSets == MaxWorkingSets)
+	return;
+    ws = &workingSets[numWorkingSets++];
+    ws->id = id;
+    ws->meanPages = meanPages;
+    ws->peakPages = peakPages;
+    ws->suspensions = suspensions;
 }
 
 //----------------------------------------------------------------------
@@ -38,7 +72,66 @@ Statistics::Print()
     printf("Disk I/O: reads %d, writes %d\n", numDiskReads, numDiskWrites);
     printf("Console I/O: reads %d, writes %d\n", numConsoleCharsRead, 
 	numConsoleCharsWritten);
-    printf("Paging: faults %d\n", numPageFaults);
+    if (numPageInWaits > 0)
+	printf("Paging: faults %d, %d on pages already being read in\n",
+	    numPageFaults, numPageInWaits);
+    else
+	printf("Paging: faults %d\n", numPageFaults);
+    if (numZeroFills + numSwapReads + numSwapWrites > 0)
+	printf("Swap: reads %d, writes %d, zero-filled pages %d\n",
+	    numSwapReads, numSwapWrites, numZeroFills);
+    if (numZeroedFramesUsed > 0)
+	printf("Zeroed frames: %d used, %d zeroed while idle\n",
+	    numZeroedFramesUsed, numFramesZeroedIdle);
+    if (numSwapCacheStores + numSwapCacheRejects > 0) {
+	printf("Swap cache: pages stored %d (%.2f:1 compression), "
+	    "rejected %d, written back %d\n", numSwapCacheStores,
+	    numSwapCacheStores > 0 ?
+		(double) numSwapCacheBytesIn / numSwapCacheBytesOut : 0.0,
+	    numSwapCacheRejects, numSwapCacheWriteBacks);
+	printf("Swap cache: read hits %d of %d (%.1f%%), "
+	    "disk transfers avoided %d\n", numSwapCacheHits,
+	    numSwapCacheHits + numSwapCacheMisses,
+	    numSwapCacheHits + numSwapCacheMisses > 0 ? 100.0 *
+		numSwapCacheHits / (numSwapCacheHits + numSwapCacheMisses) : 0.0,
+	    numSwapCacheHits + numSwapCacheStores - numSwapCacheWriteBacks);
+    }
+    if (numDirtyEvictions > 0)
+	printf("Swap-out clustering: pages %d in %d writes, %.2f per write\n",
+	    numDirtyEvictions + numClusteredPages, numDirtyEvictions,
+	    (double) (numDirtyEvictions + numClusteredPages)
+	    / numDirtyEvictions);
+    if (numMergeScans > 0)
+	printf("Page merging: frames reclaimed %d in %d scans\n",
+	    numPagesMerged, numMergeScans);
+    if (numForks > 0 || numCopiesOnWrite > 0)
+	printf("Copy on write: forks %d, pages shared %d, copies made %d\n",
+	    numForks, numForkPagesShared, numCopiesOnWrite);
+    if (numPageCacheFills > 0)
+	printf("Page cache: code pages found %d, read %d, dropped %d\n",
+	    numPageCacheHits, numPageCacheFills, numPageCacheDrops);
+    if (numCleanerBatches > 0)
+	printf("Page cleaner: pages written %d in %d batches, "
+	    "dirty evictions %d\n", numCleanerWrites, numCleanerBatches,
+	    numDirtyEvictions);
+    if (numPrefetches > 0)
+	printf("Prefetch: pages %d, hits %d, wasted %d\n", numPrefetches,
+	    numPrefetchHits, numPrefetchesWasted);
+    if (numTLBHits + numTLBMisses > 0)
+	printf("TLB: hits %d, misses %d (%.2f%% hit), refill ticks %d\n",
+	    numTLBHits, numTLBMisses,
+	    100.0 * numTLBHits / (numTLBHits + numTLBMisses),
+	    numTLBRefillTicks);
+    if (numTLBSwitches > 0)
+	printf("TLB: address space switches %d, %.1f misses per switch\n",
+	    numTLBSwitches, (double) numTLBMisses / numTLBSwitches);
+    for (int i = 0; i < numWorkingSets; i++)
+	printf("Working set: process %d, mean %d pages, peak %d, "
+	    "suspended %d times\n", workingSets[i].id,
+	    workingSets[i].meanPages, workingSets[i].peakPages,
+	    workingSets[i].suspensions);
+    if (numWorkingSets > 0)
+	printf("Load control: suspensions %d\n", numSuspensions);
     printf("Network I/O: packets received %d, sent %d\n", numPacketsRecvd, 
 	numPacketsSent);
 }
@@ -13,6 +13,19 @@
 
 #include "copyright.h"
 
+// The working set of one process, as measured at its page faults,
+// kept when the process exits.
+
+#define MaxWorkingSets	64	// processes whose working sets are kept
+
+class WorkingSetStats {
+  public:
+    int id;			// the process's thread ID
+    int meanPages;		// mean size of its working set
+    int peakPages;		// largest size of its working set
+    int suspensions;		// times it was suspended
+};
+
 // The following class defines the statistics that are to be kept
 // about Nachos behavior -- how much time (ticks) elapsed, how
 // many user instructions executed, etc.
@@ -35,9 +48,54 @@ class Statistics {
     int numPageFaults;		// number of virtual memory page faults
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
+    int numTLBHits;		// translations found in the TLB
+    int numTLBMisses;		// translations not found in the TLB
+    int numTLBRefillTicks;	// time spent in the kernel reloading the
+				// TLB after a miss
+    int numTLBSwitches;		// times the TLB was switched to another
+				// address space
+    int numZeroFills;		// pages given to a program zeroed, with
+				// nothing read
+    int numSwapReads;		// pages read from swap
+    int numSwapWrites;		// pages written to swap
+    int numPageInWaits;		// page faults on pages already on their
+				// way in from swap
+    int numDirtyEvictions;	// page faults that had to write their
+				// victim to swap first
+    int numClusteredPages;	// other pages written along with them
+    int numSwapCacheStores;	// pages the swap cache took, rather
+				// than the disk
+    int numSwapCacheBytesIn;	// their size, in all
+    int numSwapCacheBytesOut;	// and what they compressed to
+    int numSwapCacheRejects;	// pages that did not compress
+    int numSwapCacheHits;	// swap reads the cache had the page for
+    int numSwapCacheMisses;	// and those it did not
+    int numSwapCacheWriteBacks;	// pages moved from the cache to disk
+    int numMergeScans;		// times the page merger looked at memory
+    int numPagesMerged;		// frames it freed, by merging their pages
+    int numForks;		// address spaces copied by Fork
+    int numForkPagesShared;	// pages in memory they shared at once
+    int numCopiesOnWrite;	// shared pages written to, and copied
+    int numPageCacheHits;	// code pages found in the page cache
+    int numPageCacheFills;	// and read from executables into it
+    int numPageCacheDrops;	// cached pages evicted, or given up
+    int numCleanerWrites;	// pages written by the page cleaner
+    int numCleanerBatches;	// in how many batches
+    int numFramesZeroedIdle;	// free frames zeroed while the CPU was idle
+    int numZeroedFramesUsed;	// pages given a frame already zeroed
+    int numPrefetches;		// pages brought in before they faulted
+    int numPrefetchHits;	// prefetched pages that were then used
+    int numPrefetchesWasted;	// prefetched pages evicted or freed unused
+    int numSuspensions;		// processes suspended by the load
+				// controller, because memory was overcommitted
+    int numWorkingSets;		// processes in "workingSets"
+    WorkingSetStats workingSets[MaxWorkingSets];
 
     Statistics(); 		// initialize everything to zero
 
+    void RecordWorkingSet(int id, int meanPages, int peakPages,
+			  int suspensions);
+				// keep a process's working set
     void Print();		// print collected statistics
 };
 
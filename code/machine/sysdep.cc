@@ -501,3 +501,29 @@ DeallocBoundedArray(char *ptr, int size)
     mprotect(ptr + size, pgSize, PROT_READ | PROT_WRITE | PROT_EXEC);
     delete [] (ptr - pgSize);
 }
+
+//----------------------------------------------------------------------
+// AllocExecutableArray
+// 	Return an array that the host CPU may execute instructions from,
+//	for the machine simulation's translations of user code.  The
+//	array is never freed; its owner recycles it.  The generated code
+//	uses 32-bit addresses, so on a 64-bit host the array is placed in
+//	the low 4GB.
+//
+//	"size" -- amount of space needed (in bytes)
+//----------------------------------------------------------------------
+
+char *
+AllocExecutableArray(int size)
+{
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    char *ptr;
+
+#ifdef MAP_32BIT
+    flags |= MAP_32BIT;
+#endif
+    ptr = (char *) mmap(NULL, size, PROT_READ | PROT_WRITE | PROT_EXEC,
+			flags, -1, 0);
+    ASSERT(ptr != (char *) MAP_FAILED);
+    return ptr;
+}
@@ -55,6 +55,9 @@ extern int Random();
 extern char *AllocBoundedArray(int size);
 extern void DeallocBoundedArray(char *p, int size);
 
+// Allocate memory that code generated at run time can be executed from
+extern char *AllocExecutableArray(int size);
+
 // Other C library routines that are used by Nachos.
 // These are assumed to be portable, so we don't include a wrapper.
 extern "C" {
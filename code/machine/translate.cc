@@ -71,6 +71,36 @@ unsigned short
 ShortToMachine(unsigned short shortword) { return ShortToHost(shortword); }
 
 
+//----------------------------------------------------------------------
+// Machine::CachedAddress
+//      Look "virtAddr" up in the translation cache, without any of
+//	Translate's checks.  The page table entry gets its use bit set,
+//	and its dirty bit if "writing", as if Translate had been called.
+//
+// Returns:
+//	Where "virtAddr" is in mainMemory, or NULL if Translate has to
+//	be called (the page is not cached, or the access is unaligned).
+//----------------------------------------------------------------------
+
+inline char *
+Machine::CachedAddress(int virtAddr, int size, bool writing)
+{
+    unsigned int vpn = (unsigned) virtAddr / PageSize;
+    CachedTranslation *cached =
+		&translationCache[vpn & (TranslationCacheSize - 1)];
+
+    if (virtAddr & (size - 1))		// let Translate raise the error
+	return NULL;
+    if (writing) {
+	if (cached->writePage != (int) vpn)
+	    return NULL;
+	cached->entry->dirty = TRUE;
+    } else if (cached->readPage != (int) vpn)
+	return NULL;
+    cached->entry->use = TRUE;
+    return cached->page + (unsigned) virtAddr % PageSize;
+}
+
 //----------------------------------------------------------------------
 // Machine::ReadMem
 //      Read "size" (1, 2, or 4) bytes of virtual memory at "addr" into 
@@ -90,34 +120,38 @@ Machine::ReadMem(int addr, int size, int *value)
     int data;
     ExceptionType exception;
     int physicalAddress;
+    char *host = CachedAddress(addr, size, FALSE);
+
+    if (host == NULL) {
+	TRACE(TraceAddr, "Reading VA 0x%x, size %d\n", addr, size);
     
-    DEBUG('a', "Reading VA 0x%x, size %d\n", addr, size);
-    
-    exception = Translate(addr, &physicalAddress, size, FALSE);
-    if (exception != NoException) {
-	machine->RaiseException(exception, addr);
-	return FALSE;
+	exception = Translate(addr, &physicalAddress, size, FALSE);
+	if (exception != NoException) {
+	    machine->RaiseException(exception, addr);
+	    return FALSE;
+	}
+	host = &mainMemory[physicalAddress];
     }
     switch (size) {
       case 1:
-	data = machine->mainMemory[physicalAddress];
+	data = *host;
 	*value = data;
 	break;
 	
       case 2:
-	data = *(unsigned short *) &machine->mainMemory[physicalAddress];
+	data = *(unsigned short *) host;
 	*value = ShortToHost(data);
 	break;
 	
       case 4:
-	data = *(unsigned int *) &machine->mainMemory[physicalAddress];
+	data = *(unsigned int *) host;
 	*value = WordToHost(data);
 	break;
 
       default: ASSERT(FALSE);
     }
     
-    DEBUG('a', "\tvalue read = %8.8x\n", *value);
+    TRACE(TraceAddr, "\tvalue read = %8.8x\n", *value);
     return (TRUE);
 }
 
@@ -139,14 +173,24 @@ Machine::WriteMem(int addr, int size, int value)
 {
     ExceptionType exception;
     int physicalAddress;
+    char *host = CachedAddress(addr, size, TRUE);
      
-    DEBUG('a', "Writing VA 0x%x, size %d, value 0x%x\n", addr, size, value);
+    if (host != NULL)
+	physicalAddress = host - mainMemory;
+    else {
+	TRACE(TraceAddr, "Writing VA 0x%x, size %d, value 0x%x\n", 
+						addr, size, value);
 
-    exception = Translate(addr, &physicalAddress, size, TRUE);
-    if (exception != NoException) {
-	machine->RaiseException(exception, addr);
-	return FALSE;
+	exception = Translate(addr, &physicalAddress, size, TRUE);
+	if (exception != NoException) {
+	    machine->RaiseException(exception, addr);
+	    return FALSE;
+	}
     }
+    decodeCache[physicalAddress / 4].opCode = UndecodedOp;
+					// the word may have held code
+    if (inBlock[physicalAddress / 4])
+	FlushBlocks(physicalAddress / PageSize);
     switch (size) {
       case 1:
 	machine->mainMemory[physicalAddress] = (unsigned char) (value & 0xff);
@@ -186,16 +230,22 @@ Machine::WriteMem(int addr, int size, int value)
 ExceptionType
 Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 {
-    int i;
+    int i = -1;			// the TLB entry, if there is a TLB
     unsigned int vpn, offset;
     TranslationEntry *entry;
     unsigned int pageFrame;
+    CachedTranslation *cached;
+    char *host = CachedAddress(virtAddr, size, writing);
 
-    DEBUG('a', "\tTranslate 0x%x, %s: ", virtAddr, writing ? "write" : "read");
+    if (host != NULL) {
+	*physAddr = host - mainMemory;
+	return NoException;
+    }
+    TRACE(TraceAddr, "\tTranslate 0x%x, %s: ", virtAddr, writing ? "write" : "read");
 
 // check for alignment errors
     if (((size == 4) && (virtAddr & 0x3)) || ((size == 2) && (virtAddr & 0x1))){
-	DEBUG('a', "alignment problem at %d, size %d!\n", virtAddr, size);
+	TRACE(TraceAddr, "alignment problem at %d, size %d!\n", virtAddr, size);
 	return AddressErrorException;
     }
     
@@ -210,31 +260,31 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
     
     if (tlb == NULL) {		// => page table => vpn is index into table
 	if (vpn >= pageTableSize) {
-	    DEBUG('a', "virtual page # %d too large for page table size %d!\n", 
+	    TRACE(TraceAddr, "virtual page # %d too large for page table size %d!\n", 
 			virtAddr, pageTableSize);
 	    return AddressErrorException;
 	} else if (!pageTable[vpn].valid) {
-	    DEBUG('a', "virtual page # %d too large for page table size %d!\n", 
+	    TRACE(TraceAddr, "virtual page # %d too large for page table size %d!\n", 
 			virtAddr, pageTableSize);
 	    return PageFaultException;
 	}
 	entry = &pageTable[vpn];
     } else {
-        for (entry = NULL, i = 0; i < TLBSize; i++)
-    	    if (tlb[i].valid && (((unsigned int)tlb[i].virtualPage) == vpn)) {
-		entry = &tlb[i];			// FOUND!
-		break;
-	    }
-	if (entry == NULL) {				// not found
-    	    DEBUG('a', "*** no valid TLB entry found for this virtual page!\n");
+	i = TLBLookup(vpn, asid);
+	if (i < 0) {					// not found
+    	    TRACE(TraceAddr, "*** no valid TLB entry found for this virtual page!\n");
+	    stats->numTLBMisses++;
     	    return PageFaultException;		// really, this is a TLB fault,
 						// the page may be in memory,
 						// but not in the TLB
 	}
+	entry = &tlb[i];				// FOUND!
+	tlbUsed[i] = ++tlbClock;
+	stats->numTLBHits++;
     }
 
     if (entry->readOnly && writing) {	// trying to write to a read-only page
-	DEBUG('a', "%d mapped read-only at %d in TLB!\n", virtAddr, i);
+	TRACE(TraceAddr, "%d mapped read-only at %d in TLB!\n", virtAddr, i);
 	return ReadOnlyException;
     }
     pageFrame = entry->physicalPage;
@@ -242,7 +292,7 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
     // if the pageFrame is too big, there is something really wrong! 
     // An invalid translation was loaded into the page table or TLB. 
     if (pageFrame >= NumPhysPages) { 
-	DEBUG('a', "*** frame %d > %d!\n", pageFrame, NumPhysPages);
+	TRACE(TraceAddr, "*** frame %d > %d!\n", pageFrame, NumPhysPages);
 	return BusErrorException;
     }
     entry->use = TRUE;		// set the use, dirty bits
@@ -250,6 +300,45 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 	entry->dirty = TRUE;
     *physAddr = pageFrame * PageSize + offset;
     ASSERT((*physAddr >= 0) && ((*physAddr + size) <= MemorySize));
-    DEBUG('a', "phys addr = 0x%x\n", *physAddr);
+    TRACE(TraceAddr, "phys addr = 0x%x\n", *physAddr);
+
+// remember the translation, unless every access is to be traced
+    if (tlb == NULL && !TraceEnabled(TraceAddr)) {
+	cached = &translationCache[vpn & (TranslationCacheSize - 1)];
+	if (cached->readPage != (int) vpn) {
+	    cached->readPage = vpn;
+	    cached->writePage = -1;
+	    cached->entry = entry;
+	    cached->page = &mainMemory[pageFrame * PageSize];
+	}
+	if (writing)
+	    cached->writePage = vpn;
+    }
     return NoException;
 }
+
+//----------------------------------------------------------------------
+// Machine::TLBLookup
+// 	Find the TLB entry holding a valid translation for a virtual
+//	page of an address space.  Only the set the page maps to has to
+//	be searched.
+//
+//	Returns the index of the entry in "tlb", or -1 if the page is
+//	not in the TLB.  Nothing about the entry is changed, so the
+//	kernel can use this too.
+//
+//	"vpn" -- the virtual page number to look for
+//	"space" -- the ASID of the address space it belongs to
+//----------------------------------------------------------------------
+
+int
+Machine::TLBLookup(unsigned int vpn, int space)
+{
+    int first = TLBSet(vpn, space);
+
+    for (int i = first; i < first + tlbWays; i++)
+	if (tlb[i].valid && ((unsigned int) tlb[i].virtualPage) == vpn
+		&& tlb[i].asid == space)
+	    return i;
+    return -1;
+}
@@ -40,6 +40,10 @@ class TranslationEntry {
 			// page is referenced or modified.
     bool dirty;         // This bit is set by the hardware every time the
 			// page is modified.
+    int asid;		// In a TLB, the address space the translation 
+			// belongs to; the entry is ignored unless this
+			// matches the machine's ASID register.  Not used
+			// in page tables.
 };
 
 #endif
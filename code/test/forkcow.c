@@ -0,0 +1,72 @@
+/* forkcow.c
+ *    Test program for Fork, and the copy-on-write sharing of the
+ *    address space it sets up.
+ *
+ *    The parent fills an array bigger than physical memory, so that
+ *    shared pages are paged out and back in, then forks twice: once a
+ *    child that goes on from the Fork, and once one that starts at a
+ *    function.  The parent and the first child then each change every
+ *    element of the array, and check that they see their own changes,
+ *    and none of the other's.
+ *
+ *    Each process exits with 0 if all is well; otherwise, with the
+ *    number of the check that failed.
+ */
+
+#include "syscall.h"
+
+#define Size	4096	/* 16 KB: twice the size of physical memory */
+
+int A[Size];
+
+/* Sum the array. */
+int
+sum()
+{
+    int i, s;
+
+    s = 0;
+    for (i = 0; i < Size; i++)
+	s += A[i];
+    return s;
+}
+
+/* Where the second child starts. */
+void
+child()
+{
+    Exit(0);
+}
+
+int
+main()
+{
+    int i, original;
+    SpaceId first;
+
+    for (i = 0; i < Size; i++)		/* fill it before forking */
+	A[i] = i;
+    original = sum();
+
+    first = Fork(0);
+    if (first == 0) {			/* the first child */
+	if (sum() != original)		/* still the parent's copy */
+	    Exit(1);
+	for (i = 0; i < Size; i++)
+	    A[i] *= 2;
+	if (sum() != 2 * original)
+	    Exit(2);
+	Exit(0);
+    }
+
+    Fork(child);
+    for (i = 0; i < Size; i++)		/* the parent */
+	A[i] += 1000;
+    Join(first);
+    if (sum() != original + 1000 * Size)	/* untouched by the child */
+	Exit(3);
+    for (i = 0; i < Size; i++)
+	if (A[i] != i + 1000)
+	    Exit(4);
+    Exit(0);
+}
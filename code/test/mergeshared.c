@@ -0,0 +1,89 @@
+/* mergeshared.c
+ *    Test program for the page merger: a private page that comes to
+ *    hold the same data as a page shared since a Fork should be merged
+ *    into the shared frame.
+ *
+ *    The parent fills an array bigger than physical memory, puts the
+ *    same data in one page of it, and forks.  It then writes that data
+ *    into the next page, which gives it a private copy of the page,
+ *    and reads through the whole array a few times, so that memory
+ *    stays full and the page merger is woken (run with -merge).  The
+ *    child reads through the array too, keeping the first page shared.
+ *
+ *    The page merging statistics printed when Nachos halts count the
+ *    frame reclaimed.  Either way each process checks its data,
+ *    including after the parent writes to the merged page again, and
+ *    exits with 0 if all is well; otherwise, with the number of the
+ *    check that failed.
+ */
+
+#include "syscall.h"
+
+#define Size		4096	/* 16 KB: twice the size of physical memory */
+#define PageInts	64	/* a page's worth of ints (PageSize is 256) */
+#define Pattern		7777
+#define Sweeps		4
+
+int A[Size];
+
+/* Sum a page's worth of ints. */
+int
+sumPage(int *page)
+{
+    int i, s;
+
+    s = 0;
+    for (i = 0; i < PageInts; i++)
+	s += page[i];
+    return s;
+}
+
+/* Read through the whole array, several times. */
+int
+sweep()
+{
+    int i, n, s;
+
+    s = 0;
+    for (n = 0; n < Sweeps; n++)
+	for (i = 0; i < Size; i++)
+	    s += A[i];
+    return s;
+}
+
+int
+main()
+{
+    int i, expect;
+    int *shared, *private;
+
+    /* two whole pages, inside the array */
+    shared = (int *) (((int) &A[PageInts]) & ~(PageInts * sizeof(int) - 1));
+    private = shared + PageInts;
+
+    for (i = 0; i < Size; i++)
+	A[i] = i;
+    for (i = 0; i < PageInts; i++)
+	shared[i] = Pattern + i;
+    expect = sumPage(shared);
+
+    if (Fork(0) == 0) {			/* the child */
+	sweep();
+	if (sumPage(shared) != expect)
+	    Exit(1);
+	Exit(0);
+    }
+
+    for (i = 0; i < PageInts; i++)	/* the parent's private copy */
+	private[i] = Pattern + i;
+    sweep();
+    if (sumPage(private) != expect)	/* merged, or not */
+	Exit(4);
+    for (i = 0; i < PageInts; i++)	/* copied out again */
+	private[i] = i;
+    if (sumPage(private) != PageInts * (PageInts - 1) / 2)
+	Exit(5);
+    if (sumPage(shared) != expect)	/* and the shared page untouched */
+	Exit(6);
+    Exit(0);
+}
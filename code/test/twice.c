@@ -0,0 +1,23 @@
+/* twice.c
+ *    Test program for the page cache: run the same program twice, one
+ *    after the other, so that the second run finds the first's code
+ *    pages already in memory, then twice at once, so that the two
+ *    share them.
+ *
+ *    With the page cache on, the statistics printed when Nachos halts
+ *    show the code pages found in the cache.  Each run of matmult
+ *    should exit with 7220.
+ */
+
+#include "syscall.h"
+
+int
+main()
+{
+    Join(Exec("../test/matmult"));	/* after the first has exited */
+    Join(Exec("../test/matmult"));
+
+    Exec("../test/matmult");		/* both at once */
+    Join(Exec("../test/matmult"));
+    Exit(0);
+}
@@ -242,4 +242,25 @@ List::SortedRemove(int *keyPtr)
     return thing;
 }
 
+//----------------------------------------------------------------------
+// List::SortedPeek
+//      Look at the first item on a sorted list without removing it.
+//
+// Returns:
+//	Pointer to the first item, NULL if nothing on the list.
+//	Sets *keyPtr to the priority value of the first item, and
+//	*nextKeyPtr to that of the second item; a key with no item to
+//	report is left unchanged.  (Useful for finding out whether
+//	anything else has the same priority as the first item.)
+//----------------------------------------------------------------------
 
+void *
+List::SortedPeek(int *keyPtr, int *nextKeyPtr)
+{
+    if (IsEmpty())
+	return NULL;
+    *keyPtr = first->key;
+    if (first->next != NULL)
+	*nextKeyPtr = first->next->key;
+    return first->item;
+}
@@ -28,6 +28,7 @@ class ListElement {
    public:
      ListElement(void *itemPtr, int sortKey);	// initialize a list element
 
+     ListElement *next;		// next element on list,
 				// NULL if this is the last
      int key;		    	// priority, for a sorted list
      void *item; 	    	// pointer to item on the list
@@ -55,6 +56,8 @@ class List {
     // Routines to put/get items on/off list in order (sorted by key)
     void SortedInsert(void *item, int sortKey);	// Put item into list
     void *SortedRemove(int *keyPtr); 	  	// Remove first item from list
+    void *SortedPeek(int *keyPtr, int *nextKeyPtr);	// Look at first item,
+						// and the key after it
 	int getSize();
 
   private:
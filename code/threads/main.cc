@@ -8,8 +8,14 @@
 //
 // 	Most of this file is not needed until later assignments.
 //
-// Usage: nachos -d <debugflags> -rs <random seed #>
-//		-s -x <nachos file> -c <consoleIn> <consoleOut>
+// Usage: nachos -d <debugflags> -T <trace file> -rs <random seed #>
+//		-s -x <nachos file> -c <consoleIn> <consoleOut> -I <engine>
+//		-V <page replacement policy> -pf <pages> -sc <pages>
+//		-clean <low> <high> -swapcache <percent> -merge <faults>
+//		-pagecache <pages>
+//		-tlb <entries> -tlbways <ways> -tlbrepl <policy>
+//		-tlbasids <ASIDs>
+//		-P <sample rate>
 //		-f -cp <unix file> <nachos file>
 //		-p <nachos file> -r <nachos file> -l -D -t
 //              -n <network reliability> -m <machine id>
@@ -17,6 +23,8 @@
 //              -z
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
+//    -T saves the messages from the busiest paths (the TRACE ones) in a
+//	 file instead, to be printed by bin/tracedump
 //    -rs causes Yield to occur at random (but repeatable) spots
 //    -z prints the copyright message
 //
@@ -24,6 +32,44 @@
 //    -s causes user programs to be executed in single-step mode
 //    -x runs a user program
 //    -c tests the console
+//    -V selects how pages are replaced when memory is full: 1 first in,
+//	 first out, 2 at random, 3 by the clock algorithm, 4 by the clock
+//	 algorithm preferring pages that are not dirty, 5 by the WSClock
+//	 algorithm, keeping each process's working set, and suspending
+//	 processes while their working sets do not fit in memory
+//    -pf brings in up to <pages> pages following a page that faults,
+//	 while there are free frames (by default, 8; 0 turns this off)
+//    -sc writes up to <pages> dirty pages of a process to swap together
+//	 when one of them is evicted, if memory is tight (by default, 8;
+//	 1 writes each page on its own)
+//    -clean has the page cleaner write dirty pages to swap ahead of
+//	 their eviction whenever fewer than <low> frames are clean, until
+//	 <high> are (by default, 4 and 8; a <low> of 0 turns it off)
+//    -swapcache keeps evicted pages compressed in a pool of up to
+//	 <percent> of the size of main memory, in front of the swap disk
+//	 (by default, 25; 0 turns it off)
+//    -merge has the page merger look for frames holding the same data,
+//	 and keep only one copy, every <faults> page faults while memory
+//	 is full (by default, 16; 0 turns it off)
+//    -pagecache shares the pages of a program's code among all the
+//	 processes running it, and keeps up to <pages> of them in memory
+//	 after the last one exits (by default, 8; 0 turns this off)
+//    -I selects how user instructions are run: 0 (the default) decodes
+//	 and executes one at a time, 1 runs translated basic blocks,
+//	 2 also compiles the busiest blocks to host machine code
+//    -tlb translates user addresses through a TLB of <entries> entries,
+//	 reloaded by the kernel from the page tables on a miss; 0 means
+//	 no TLB
+//    -tlbways sets how many entries of the TLB are searched for each
+//	 page: at least 2, and by default 4
+//    -tlbrepl selects which entry the kernel replaces: 1 the oldest,
+//	 2 (the default) a random one, 3 the least recently used
+//    -tlbasids limits how many address spaces can have translations in
+//	 the TLB at once (by default, 64); with 1, the TLB is emptied on
+//	 every switch between address spaces
+//    -P profiles user programs, sampling the PC every <sample rate> user
+//	 instructions, or with 0, counting every instruction and basic
+//	 block; the profiles are printed when Nachos halts
 //
 //  FILESYS
 //    -f causes the physical disk to be formatted
@@ -19,14 +19,6 @@ Statistics *stats;			// performance metrics
 Timer *timer;				// the hardware timer device,
 					// for invoking context switches
 
-//Begin code changes by Chet Ransonet
-Semaphore ** pageLock;
-//End code changes by Chet Ransonet
-
-//Begin code changes by Ben Matkin
-Thread * ipt[NumPhysPages];
-List * pageList = new List();
-//End code changes by Ben Matkin
 int threadChoice;
 int memChoice;
 int swapChoice;
@@ -40,6 +32,17 @@ FileSystem  *fileSystem;
 
 #ifdef USER_PROGRAM
 Machine *machine;	// user program memory and registers
+FrameTable *frameTable;	// what is in each frame of memory
+SwapDevice *swapDevice;	// where evicted pages are kept
+PageCleaner *pageCleaner;	// writes dirty pages ahead of eviction
+PageMerger *pageMerger;		// shares frames holding the same data
+PageCache *pageCache;		// frames holding programs' code
+int engineChoice;	// how Machine::Run executes instructions
+int tlbChoice;		// how the kernel replaces TLB entries
+int tlbAsids;		// how many ASIDs the kernel hands out
+int prefetchPages;	// how far ahead of a page fault to read
+int swapCluster;	// most pages to write to swap at once
+Profiler *profiler;	// where user programs spend their time
 List* activeThreads;
 int threadID;
 #endif
@@ -96,10 +99,28 @@ Initialize(int argc, char **argv)
 {
     int argCount;
     char* debugArgs = "";
+    char* traceFile = NULL;	// print TRACE messages
     bool randomYield = FALSE;
 
 #ifdef USER_PROGRAM
     bool debugUserProg = FALSE;	// single step user program
+#ifdef USE_TLB
+    int tlbEntries = TLBSize;	// size of the TLB
+#else
+    int tlbEntries = 0;		// no TLB, just page tables
+#endif
+    int tlbAssoc = 0;		// entries in each set of the TLB
+    int cleanerLow = CleanerLow;	// page cleaner watermarks
+    int cleanerHigh = CleanerHigh;
+    int swapCachePercent = SwapCachePercent;	// swap cache size
+    int mergeInterval = MergeInterval;	// page faults between merger scans
+    int pageCachePages = PageCachePages;	// unused code pages to keep
+    engineChoice = InterpretEngine;
+    tlbChoice = TLBRandom;
+    tlbAsids = NumASIDs;
+    prefetchPages = PrefetchPages;
+    swapCluster = SwapCluster;
+    profiler = NULL;
 	pageFlag = false;
 #endif
 #ifdef FILESYS_NEEDED
@@ -119,6 +140,10 @@ Initialize(int argc, char **argv)
 	    	debugArgs = *(argv + 1);
 	    	argCount = 2;
 	    }
+	} else if (!strcmp(*argv, "-T")) {
+	    ASSERT(argc > 1);
+	    traceFile = *(argv + 1);
+	    argCount = 2;
 	} else if (!strcmp(*argv, "-rs")) {
 	    ASSERT(argc > 1);
 	    RandomInit(atoi(*(argv + 1)));	// initialize pseudo-random
@@ -154,6 +179,73 @@ Initialize(int argc, char **argv)
 	    debugUserProg = TRUE;
 	if(!strcmp(*argv, "-E"))
 		pageFlag = true;
+	if (!strcmp(*argv, "-I")) {
+	    ASSERT(argc > 1);
+	    engineChoice = atoi(*(argv + 1));
+	    argCount = 2;
+	}
+	if (!strcmp(*argv, "-tlb")) {
+	    ASSERT(argc > 1);
+	    tlbEntries = atoi(*(argv + 1));
+	    argCount = 2;
+	}
+	if (!strcmp(*argv, "-tlbways")) {
+	    ASSERT(argc > 1);
+	    tlbAssoc = atoi(*(argv + 1));
+	    argCount = 2;
+	}
+	if (!strcmp(*argv, "-tlbrepl")) {
+	    ASSERT(argc > 1);
+	    tlbChoice = atoi(*(argv + 1));
+	    argCount = 2;
+	}
+	if (!strcmp(*argv, "-tlbasids")) {
+	    ASSERT(argc > 1);
+	    tlbAsids = atoi(*(argv + 1));
+	    ASSERT(tlbAsids > 0 && tlbAsids <= NumASIDs);
+	    argCount = 2;
+	}
+	if (!strcmp(*argv, "-pf")) {
+	    ASSERT(argc > 1);
+	    prefetchPages = atoi(*(argv + 1));
+	    ASSERT(prefetchPages >= 0);
+	    argCount = 2;
+	}
+	if (!strcmp(*argv, "-sc")) {
+	    ASSERT(argc > 1);
+	    swapCluster = atoi(*(argv + 1));
+	    ASSERT(swapCluster > 0 && swapCluster <= NumPhysPages);
+	    argCount = 2;
+	}
+	if (!strcmp(*argv, "-swapcache")) {
+	    ASSERT(argc > 1);
+	    swapCachePercent = atoi(*(argv + 1));
+	    ASSERT(swapCachePercent >= 0);
+	    argCount = 2;
+	}
+	if (!strcmp(*argv, "-merge")) {
+	    ASSERT(argc > 1);
+	    mergeInterval = atoi(*(argv + 1));
+	    ASSERT(mergeInterval >= 0);
+	    argCount = 2;
+	}
+	if (!strcmp(*argv, "-pagecache")) {
+	    ASSERT(argc > 1);
+	    pageCachePages = atoi(*(argv + 1));
+	    ASSERT(pageCachePages >= 0 && pageCachePages <= NumPhysPages);
+	    argCount = 2;
+	}
+	if (!strcmp(*argv, "-clean")) {
+	    ASSERT(argc > 2);
+	    cleanerLow = atoi(*(argv + 1));
+	    cleanerHigh = atoi(*(argv + 2));
+	    argCount = 3;
+	}
+	if (!strcmp(*argv, "-P")) {
+	    ASSERT(argc > 1);
+	    profiler = new Profiler(atoi(*(argv + 1)));
+	    argCount = 2;
+	}
 #endif
 #ifdef FILESYS_NEEDED
 	if (!strcmp(*argv, "-f"))
@@ -173,6 +265,7 @@ Initialize(int argc, char **argv)
     }
 
     DebugInit(debugArgs);			// initialize DEBUG messages
+    TraceInit(traceFile);			// and where TRACE messages go
     stats = new Statistics();			// collect statistics
     interrupt = new Interrupt;			// start up interrupt handling
     scheduler = new Scheduler();		// initialize the ready queue
@@ -194,7 +287,14 @@ Initialize(int argc, char **argv)
 	
 #ifdef USER_PROGRAM
 	memMap = new BitMap(NumPhysPages);
-	machine = new Machine(debugUserProg);
+	frameTable = new FrameTable(NumPhysPages);
+	swapDevice = new SwapDevice("SWAP", swapCachePercent * MemorySize / 100);
+	pageCleaner = new PageCleaner(cleanerLow, cleanerHigh);
+	pageMerger = new PageMerger(mergeInterval);
+	pageCache = new PageCache(NumPhysPages, pageCachePages);
+	if (tlbAssoc == 0)
+	    tlbAssoc = (tlbEntries < TLBWays) ? tlbEntries : TLBWays;
+	machine = new Machine(debugUserProg, tlbEntries, tlbAssoc);
 
 
 	activeThreads = new List();	// Make the active threads list.
@@ -227,8 +327,14 @@ Cleanup()
     
 #ifdef USER_PROGRAM
     delete machine;
+    delete profiler;
 	delete activeThreads;
 	delete memMap;
+	delete frameTable;
+	delete swapDevice;
+	delete pageCleaner;
+	delete pageMerger;
+	delete pageCache;
 #endif
 
 #ifdef FILESYS_NEEDED
@@ -243,6 +349,7 @@ Cleanup()
     delete scheduler;
     delete interrupt;
     
+    TraceDump();
     Exit(0);
 }
 
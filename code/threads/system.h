@@ -37,18 +37,32 @@ extern int memChoice;
 extern int swapChoice;
 extern bool pageFlag;
 
-extern Semaphore ** pageLock;
-
-//Begin code changes by Ben Matkin
-extern Thread * ipt[NumPhysPages];
-extern List * pageList;
-//End code changes by Ben Matkin
-
 extern BitMap *memMap;				//Bitmap to keep track of memory use
 
 #ifdef USER_PROGRAM
 #include "machine.h"
 extern Machine* machine;	// user program memory and registers
+#include "frametable.h"
+extern FrameTable *frameTable;	// what is in each frame of memory
+#include "swapdevice.h"
+extern SwapDevice *swapDevice;	// where evicted pages are kept
+#include "pagecleaner.h"
+extern PageCleaner *pageCleaner;	// writes dirty pages ahead of eviction
+#include "pagemerger.h"
+extern PageMerger *pageMerger;	// shares frames holding the same data
+#include "pagecache.h"
+extern PageCache *pageCache;	// frames holding programs' code
+extern int engineChoice;	// InterpretEngine, BlockEngine or JitEngine
+extern int tlbChoice;		// how TLB entries are replaced, numbered
+				// like swapChoice:
+#define TLBFIFO		1	//	oldest entry of the set
+#define TLBRandom	2	//	any entry of the set
+#define TLBLRU		3	//	least recently used entry of the set
+extern int tlbAsids;		// how many ASIDs address spaces can have
+extern int prefetchPages;	// most pages brought in after a page fault
+extern int swapCluster;		// most pages written to swap at once
+#include "profile.h"
+extern Profiler *profiler;	// user program profiler, or NULL
 extern List* activeThreads;	// active thread list for process management
 extern int threadID;	// unique process id
 #endif
@@ -223,7 +223,10 @@ Thread::Yield ()
 //	we have no thread to run.  "Interrupt::Idle" is called
 //	to signify that we should idle the CPU until the next I/O interrupt
 //	occurs (the only thing that could cause a thread to become
-//	ready to run).
+//	ready to run).  But first, unless a thread is only waiting for
+//	the swap device, a process suspended because memory was
+//	overcommitted can run; and the idle time is used to zero free
+//	frames.
 //
 //	NOTE: we assume interrupts are already disabled, because it
 //	is called from the synchronization routines which must
@@ -242,8 +245,14 @@ Thread::Sleep ()
     //DEBUG('t', "Sleeping thread \"%i\"\n", getID());
 
     status = BLOCKED;
-    while ((nextThread = scheduler->FindNextToRun()) == NULL)
+    while ((nextThread = scheduler->FindNextToRun()) == NULL) {
+#ifdef USER_PROGRAM
+	if (!swapDevice->Busy() && AddrSpace::ResumeProcess(TRUE))
+	    continue;		// rather than leave a process suspended
+	frameTable->ZeroFreeFrames();	// while there is time to
+#endif
 	interrupt->Idle();	// no one to run, wait for an interrupt
+    }
 
     scheduler->Run(nextThread); // returns when we've been signalled
 }
@@ -105,7 +105,6 @@ class Thread {
 	
 	void setID(int ID);	// Set a new ID.
 	bool isJoined;	// Used to determine if we've already joined to a child process.
-    void loadIntoIPT();
   private:
     // some of the private data for this class is listed above
     
@@ -23,6 +23,28 @@
 
 static char *enableFlags = NULL; // controls which DEBUG messages are printed 
 
+unsigned int traceMask = 0;	// controls which TRACE messages are printed
+static const char *traceFlags = "aimd"; // the debug flag of each trace
+					// category
+
+// Saved TRACE messages are kept unformatted: the format string, and the
+// arguments it converts.  Once the ring is full, each new message
+// replaces the oldest one.
+
+#define TraceRingSize	16384	// number of messages kept (a power of 2)
+#define TraceMaxArgs	6	// most arguments a message can have
+#define TraceMagic	0x4e545243 // identifies a trace file; see TraceDump
+
+class TraceRecord {
+  public:
+    char *format;		// the message's format string
+    long args[TraceMaxArgs];	// its arguments: ints, or char *'s for %s
+};
+
+static TraceRecord *traceRing = NULL;	// NULL if messages are printed
+static char *traceFileName;		// where TraceDump writes them
+static unsigned int traceCount = 0;	// messages saved so far
+
 //----------------------------------------------------------------------
 // DebugInit
 //      Initialize so that only DEBUG messages with a flag in flagList 
@@ -38,6 +60,10 @@ void
 DebugInit(char *flagList)
 {
     enableFlags = flagList;
+    traceMask = 0;
+    for (int i = 0; traceFlags[i] != '\0'; i++)
+	if (DebugIsEnabled(traceFlags[i]))
+	    traceMask |= 1 << i;
 }
 
 //----------------------------------------------------------------------
@@ -73,3 +99,141 @@ DEBUG(char flag, char *format, ...)
 	fflush(stdout);
     }
 }
+
+//----------------------------------------------------------------------
+// TraceInit
+//      Save TRACE messages in a ring buffer, rather than printing them,
+//	and have TraceDump write them to "fileName".  If "fileName" is 
+//	NULL, keep printing them.
+//----------------------------------------------------------------------
+
+void
+TraceInit(char *fileName)
+{
+    if (fileName == NULL)
+	return;
+    traceFileName = fileName;
+    traceRing = new TraceRecord[TraceRingSize];
+}
+
+//----------------------------------------------------------------------
+// ConversionEnd
+//      Skip over the flags, field width, precision and length of a
+//	printf conversion.
+//
+//	"p" -- the '%' that starts the conversion
+//
+// Returns:
+//	The conversion character, e.g. 'd' in "%8d".
+//----------------------------------------------------------------------
+
+static char *
+ConversionEnd(char *p)
+{
+    for (p++; *p != '\0' && strchr("-+ #0123456789.hl", *p) != NULL; p++)
+	;
+    return p;
+}
+
+//----------------------------------------------------------------------
+// Trace
+//      Called by TRACE once the message's category is known to be
+//	enabled.  Print the message like DEBUG does, or if TraceInit
+//	was given a file, save it in the ring buffer.
+//
+//	The saved arguments are only formatted by TraceDump, so any 
+//	string passed for %s must not change until then.
+//----------------------------------------------------------------------
+
+void 
+Trace(char *format, ...)
+{
+    va_list ap;
+    TraceRecord *record;
+    int numArgs = 0;
+
+    va_start(ap, format);
+    if (traceRing == NULL) {
+	vfprintf(stdout, format, ap);
+	fflush(stdout);
+    } else {
+	record = &traceRing[traceCount++ % TraceRingSize];
+	record->format = format;
+	for (char *p = format; *p != '\0'; p++) {
+	    if (*p != '%')
+		continue;
+	    p = ConversionEnd(p);
+	    if (*p == '\0')
+		break;
+	    if (*p == '%')
+		continue;
+	    ASSERT(numArgs < TraceMaxArgs);
+	    if (*p == 's')
+		record->args[numArgs++] = (long) va_arg(ap, char *);
+	    else
+		record->args[numArgs++] = va_arg(ap, int);
+	}
+    }
+    va_end(ap);
+}
+
+//----------------------------------------------------------------------
+// WriteString
+//      Write a string to a trace file: its length, then its characters.
+//----------------------------------------------------------------------
+
+static void
+WriteString(int fd, char *string)
+{
+    int length = strlen(string);
+
+    WriteFile(fd, (char *) &length, sizeof(int));
+    WriteFile(fd, string, length);
+}
+
+//----------------------------------------------------------------------
+// TraceDump
+//      Write the messages in the ring buffer, oldest first, to the file
+//	given to TraceInit.  Called when Nachos halts.
+//
+//	The file holds host-order ints: TraceMagic, the number of 
+//	messages, then for each message, its format string and each
+//	argument it converts.  Strings are written as their length
+//	followed by their characters; all other arguments as an int.
+//----------------------------------------------------------------------
+
+void
+TraceDump()
+{
+    int fd, magic = TraceMagic, count;
+    TraceRecord *record;
+    int numArgs, value;
+
+    if (traceRing == NULL)
+	return;
+    fd = OpenForWrite(traceFileName);
+    count = (traceCount < TraceRingSize) ? traceCount : TraceRingSize;
+    WriteFile(fd, (char *) &magic, sizeof(int));
+    WriteFile(fd, (char *) &count, sizeof(int));
+    for (unsigned int i = traceCount - count; i != traceCount; i++) {
+	record = &traceRing[i % TraceRingSize];
+	WriteString(fd, record->format);
+	numArgs = 0;
+	for (char *p = record->format; *p != '\0'; p++) {
+	    if (*p != '%')
+		continue;
+	    p = ConversionEnd(p);
+	    if (*p == '\0')
+		break;
+	    if (*p == '%')
+		continue;
+	    if (*p == 's')
+		WriteString(fd, (char *) record->args[numArgs++]);
+	    else {
+		value = (int) record->args[numArgs++];
+		WriteFile(fd, (char *) &value, sizeof(int));
+	    }
+	}
+    }
+    Close(fd);
+}
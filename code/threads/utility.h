@@ -16,6 +16,15 @@
 //   	'a' -- address spaces (USER_PROGRAM)
 //   	'n' -- network emulation (NETWORK)
 //
+//	Messages on paths that run for every instruction, memory access
+//	or clock tick use TRACE instead of DEBUG.  The flags they belong
+//	to are also kept as a bitmask, so a disabled message costs one
+//	test, and compiling with -DTRACE_CATEGORIES=0 removes them all.
+//	With -T <file>, these messages are saved in binary form in a
+//	ring buffer instead of being printed, and the most recent ones
+//	are written to <file> when Nachos halts; bin/tracedump prints
+//	them.
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -65,6 +74,40 @@ extern bool DebugIsEnabled(char flag); 	// Is this debug flag enabled?
 extern void DEBUG (char flag, char* format, ...);  	// Print debug message 
 							// if flag is enabled
 
+// Interface to tracing.  Each category is the debug flag of the same
+// name, as a bit.
+
+#define TraceAddr	0x01		// 'a' -- address translation
+#define TraceInt	0x02		// 'i' -- interrupts and clock ticks
+#define TraceMachine	0x04		// 'm' -- instruction execution
+#define TraceDisk	0x08		// 'd' -- disk emulation
+
+#ifndef TRACE_CATEGORIES
+#define TRACE_CATEGORIES	(~0)	// categories compiled in
+#endif
+
+extern unsigned int traceMask;		// categories enabled by DebugInit
+
+#define TraceEnabled(category)						\
+    ((TRACE_CATEGORIES & (category)) && (traceMask & (category)))
+
+// A message saved by TraceInit's ring buffer keeps the pointers to its
+// %s arguments, and is only formatted by TraceDump, so they must point
+// to strings that never change.  Every TRACE passes string literals,
+// or entries of static tables of them (e.g. intTypeNames).
+
+#define TRACE(category, format, ...)					\
+    do {								\
+	if (TraceEnabled(category))					\
+	    Trace(format, ##__VA_ARGS__);				\
+    } while (0)
+
+extern void TraceInit(char *fileName);	// save traces, instead of
+					// printing them
+extern void Trace(char *format, ...);	// Print or save a message; %s
+					// arguments must be constant
+extern void TraceDump();		// write out the saved traces
+
 //----------------------------------------------------------------------
 // ASSERT
 //      If condition is false,  print a message and dump core.
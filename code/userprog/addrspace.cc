@@ -22,6 +22,21 @@
 
 extern int swapChoice;
 
+// With a TLB, the address space holding each ASID, and how many times
+// the kernel has run out of ASIDs (see AddrSpace::AssignASID).
+
+static AddrSpace *asidOwner[NumASIDs];
+static unsigned int currentGeneration = 1;
+static AddrSpace *tlbSpace = NULL;	// the address space the TLB was
+					// last switched to
+
+// Every address space, and the threads of the processes the load
+// controller has suspended, in the order they were suspended (see
+// AddrSpace::ControlLoad).
+
+static AddrSpace *allSpaces = NULL;
+static List *suspendedThreads = new List();
+
 //----------------------------------------------------------------------
 // SwapHeader
 // 	Do little endian to big endian conversion on the bytes in the 
@@ -56,24 +71,41 @@ SwapHeader (NoffHeader *noffH)
 //	memory.  For now, this is really simple (1:1), since we are
 //	only uniprogramming, and we have a single unsegmented page table
 //
+//	Whatever of the program's code is in the page cache is mapped at
+//	once.
+//
 //	"executable" is the file containing the object code to load into memory
+//	"name" is its name, which the page cache knows the program by
 //----------------------------------------------------------------------
 
-AddrSpace::AddrSpace(OpenFile *executable)
+AddrSpace::AddrSpace(OpenFile *executable, char *name)
 {
 	// Begin code changes by Chet Ransonet
 	file = executable;
+	profile = NULL;
+	asid = -1;
+	asidGeneration = 0;		// no ASID yet
+	virtualTime = 0;
+	running = FALSE;
+	suspended = FALSE;
+	lastFault = 0;
+	wsSamples = wsTotal = wsPeak = suspensions = 0;
+	nextSpace = allSpaces;
+	allSpaces = this;
 	
     //NoffHeader noffH;
 	// End code changes by Chet Ransonet
     unsigned int i, size, counter;
 	space = false;
+	fileUsers = new int;
+	*fileUsers = 1;
+	program = pageCache->Program(name);
 	
     executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
-    if ((noffH.noffMagic != NOFFMAGIC) && 
-		(WordToHost(noffH.noffMagic) == NOFFMAGIC))
+    if (((noffH.noffMagic & ~NOFFALIGNED) != NOFFMAGIC) && 
+		((WordToHost(noffH.noffMagic) & ~NOFFALIGNED) == NOFFMAGIC))
     	SwapHeader(&noffH);
-    ASSERT(noffH.noffMagic == NOFFMAGIC);
+    ASSERT((noffH.noffMagic & ~NOFFALIGNED) == NOFFMAGIC);
 
 // how big is address space?
     size = noffH.code.size + noffH.initData.size + noffH.uninitData.size 
@@ -82,9 +114,14 @@ AddrSpace::AddrSpace(OpenFile *executable)
     numPages = divRoundUp(size, PageSize); 
     size = numPages * PageSize;
     
-	Swap(size + 6000);
-	//swapFile = fileSystem->Open(swapfilename);
-	swapped = new bool[numPages];
+	swapSlot = new int[numPages];
+	lastUse = new int[numPages];
+	prefetched = new bool[numPages];
+	prefetchWindow = 1;
+	nextSequential[0] = 0;		// programs start at the beginning
+	for (i = 1; i < PrefetchStreams; i++)
+		nextSequential[i] = -1;
+	nextStream = 1;
 
 	//Change this to reference the bitmap for free pages
 	//instead of total amount of pages
@@ -140,7 +177,12 @@ AddrSpace::AddrSpace(OpenFile *executable)
 		//Take the global bitmap and set the relevant chunks
 		//to indicate that the memory is in use
 		//memMap->Mark(i + startPage);
+		lastUse[i] = -WSWindow - 1;	// not in the working set
+		prefetched[i] = FALSE;
+		swapSlot[i] = -1;		// nothing on the swap device yet
     }
+    for (i = 0; i < numPages; i++)
+	(void) MapCached(i);
 	
 	//memMap->Print();
 
@@ -175,38 +217,263 @@ AddrSpace::AddrSpace(OpenFile *executable)
 */
 }
 
-//Begin code changes by Ben Matkin
-void loadThreadIntoIPT(int virtualPageNum)
+//----------------------------------------------------------------------
+// AddrSpace::AddrSpace
+// 	Create a copy of an address space, for Fork, without copying any
+//	of its memory.  Each page of the parent that is in memory shares
+//	its frame with the copy's, read-only in both, until one of them
+//	writes to it (see CopyOnWrite); each page in a swap slot shares
+//	the slot.  The rest have never been changed, and are built from
+//	the executable, which the two share, when they are first used.
+//	So a copy costs a page table, not an address space.
+//
+//	Pages on their way into memory are waited for first, since only
+//	pages that are there can be shared.  Once there are none, nothing
+//	here gives up the CPU, so the parent cannot change while it is
+//	being copied.
+//
+//	"parent" -- the address space to copy
+//----------------------------------------------------------------------
+
+AddrSpace::AddrSpace(AddrSpace *parent)
 {
+	unsigned int i;
+	int frame;
+	bool waited;
 
-/* //The problem with this function is that it's looking for an empty physical page and when the physical memory fills up, it does not load the thread into the ipt.  We already know which page the currentThread needs to take up, we don't need to look for a new, empty page.
- 	//Load page into IPT
-	int processID = currentThread->getID();
-	//int * threadPointer = (int *) currentThread;
-	bool loadedIPT = FALSE;
-	//Thread * testThread = (Thread *) threadPointer;
-	for (int i = 0; i < NumPhysPages - 1; i++) {
-		//printf("Iterator - %d\n", i);
-		if ( ipt[i] == NULL) {
-			ipt[i] = currentThread;
-			loadedIPT = TRUE;
-			break;
+	do {
+		waited = FALSE;
+		for(i = 0; i < parent->numPages; i++)
+		{
+			frame = parent->pageTable[i].physicalPage;
+			if(frame != -1 && !parent->pageTable[i].valid)
+			{
+				frameTable->WaitForTransfer(frame);
+				waited = TRUE;
+			}
+		}
+	} while (waited);
+
+	file = parent->file;
+	fileUsers = parent->fileUsers;
+	(*fileUsers)++;
+	program = pageCache->Program(parent->program);
+	noffH = parent->noffH;
+	profile = parent->profile;
+	asid = -1;
+	asidGeneration = 0;
+	virtualTime = 0;
+	running = FALSE;
+	suspended = FALSE;
+	lastFault = 0;
+	wsSamples = wsTotal = wsPeak = suspensions = 0;
+	nextSpace = allSpaces;
+	allSpaces = this;
+	space = true;
+	startPage = 0;
+
+	numPages = parent->numPages;
+	pageTable = new TranslationEntry[numPages];
+	swapSlot = new int[numPages];
+	lastUse = new int[numPages];
+	prefetched = new bool[numPages];
+	prefetchWindow = 1;
+	for (i = 0; i < PrefetchStreams; i++)
+		nextSequential[i] = -1;
+	nextStream = 0;
+
+	parent->FlushTLB();
+	for (i = 0; i < numPages; i++) {
+		pageTable[i] = parent->pageTable[i];
+		pageTable[i].use = FALSE;
+		lastUse[i] = -WSWindow - 1;
+		prefetched[i] = FALSE;
+		swapSlot[i] = parent->swapSlot[i];
+		if (swapSlot[i] != -1)
+			swapDevice->ShareSlot(swapSlot[i]);
+		if (pageTable[i].valid) {
+			parent->pageTable[i].readOnly = TRUE;
+			pageTable[i].readOnly = TRUE;
+			frameTable->Share(pageTable[i].physicalPage, this, i);
+			stats->numForkPagesShared++;
 		}
 	}
+	machine->FlushTranslations();
+	stats->numForks++;
+}
 
-	if (loadedIPT)
-		printf("Process %i request VPN %i.\n", processID, virtualPageNum );
-	else 
-		ASSERT(false);
-*/
+//----------------------------------------------------------------------
+// ClockVictim
+// 	Choose a frame to evict with the clock algorithm.  The frames
+//	form a circle, swept by a hand.  A frame whose page was used
+//	since the hand last passed has its use bit cleared, and is
+//	given a second chance; the first frame found unused is evicted.
+//
+//	If "enhanced", pages that are not dirty, and so need not be
+//	written out, are preferred: the hand first looks for a page
+//	neither used nor dirty, without clearing anything; then for a
+//	page that is unused but dirty, clearing use bits as it goes;
+//	and then starts over, with every use bit now clear.
+//
+//	Pinned frames are skipped.  A shared frame is used, or dirty, if
+//	any of its pages is.  With a TLB, the up to date use and dirty
+//	bits may be in the TLB; FrameTable::IsUsed and IsDirty write them
+//	back (and drop the TLB entries, so that later uses are seen)
+//	before they are looked at.
+//
+//	Returns -1 if every frame is pinned.
+//----------------------------------------------------------------------
+
+static int clockHand = 0;		// the next frame the hand looks at
+
+static int
+ClockVictim(bool enhanced)
+{
+	int frame;
+
+	for (int pass = 0; pass < 4; pass++) {
+		for (int n = 0; n < NumPhysPages; n++) {
+			frame = clockHand;
+			clockHand = (clockHand + 1) % NumPhysPages;
+			if (frameTable->IsPinned(frame))
+				continue;
+			if (!enhanced) {
+				if (!frameTable->IsUsed(frame))
+					return frame;
+				frameTable->ClearUse(frame);
+			} else if (pass % 2 == 0) {
+				if (!frameTable->IsUsed(frame)
+				    && !frameTable->IsDirty(frame))
+					return frame;
+			} else {
+				if (!frameTable->IsUsed(frame))
+					return frame;
+				frameTable->ClearUse(frame);
+			}
+		}
+	}
+	return -1;		// every frame is pinned
+}
+
+//----------------------------------------------------------------------
+// WSClockVictim
+// 	Choose a frame to evict with the WSClock algorithm: the clock
+//	algorithm, but a page is only evicted once it has left its
+//	process's working set -- it has not been used for WSWindow of
+//	the process's own virtual time -- or its process is suspended.
+//	Clean pages are preferred on the first trip around.  A shared
+//	frame stays while it is in the working set of any process
+//	sharing it that is not suspended.
+//
+//	If every page is in a working set, memory is overcommitted
+//	(the load controller should soon suspend someone), and the
+//	page used longest ago is evicted.  Returns -1 if every frame
+//	is pinned.
+//----------------------------------------------------------------------
+
+static int
+WSClockVictim()
+{
+	FrameEntry *owner;
+	FrameSharer *sharer;
+	int frame, age, oldest = -1, oldestAge = -1;
+	bool wanted;
+
+	for (int pass = 0; pass < 2; pass++) {
+		for (int n = 0; n < NumPhysPages; n++) {
+			frame = clockHand;
+			clockHand = (clockHand + 1) % NumPhysPages;
+			if (frameTable->IsPinned(frame))
+				continue;
+			owner = frameTable->Entry(frame);
+			age = owner->space->PageAge(owner->virtualPage);
+			wanted = age <= WSWindow && !owner->space->suspended;
+			for (sharer = owner->sharers; sharer != NULL;
+			     sharer = sharer->next) {
+				int sharerAge =
+				    sharer->space->PageAge(sharer->virtualPage);
+
+				age = min(age, sharerAge);
+				wanted = wanted || (sharerAge <= WSWindow
+						    && !sharer->space->suspended);
+			}
+			if (age > oldestAge) {
+				oldest = frame;
+				oldestAge = age;
+			}
+			if (wanted)
+				continue;
+			if (pass == 1 || !frameTable->IsDirty(frame))
+				return frame;
+		}
+	}
+	return oldest;
+}
+
+//----------------------------------------------------------------------
+// FIFOVictim
+// 	Choose the frame whose page was brought in longest ago, that is
+//	not pinned.  Returns -1 if every frame is pinned.
+//----------------------------------------------------------------------
+
+static int
+FIFOVictim()
+{
+	FrameEntry *entry;
+
+	for (entry = frameTable->loaded.First(); entry != NULL; entry = entry->next)
+		if (!entry->pinned)
+			return frameTable->FrameOf(entry);
+	return -1;		// every frame is pinned
 }
-//End code changes by Ben Matkin
 
+//----------------------------------------------------------------------
+// AddrSpace::ReplacementOrder
+// 	List every frame in the order the page replacement policy will
+//	look at it: oldest first for FIFO, and from the clock hand on
+//	for the others (random replacement has no order, so the clock
+//	hand's will do).  The page cleaner uses this to clean the pages
+//	that will be evicted soonest.
+//
+//	"frames" -- where to put the list, NumPhysPages long
+//----------------------------------------------------------------------
+
+void AddrSpace::ReplacementOrder(int *frames)
+{
+	FrameEntry *entry;
+	int n = 0;
+
+	if (swapChoice == 1) {
+		for (entry = frameTable->loaded.First(); entry != NULL;
+		     entry = entry->next)
+			frames[n++] = frameTable->FrameOf(entry);
+		for (int frame = 0; frame < NumPhysPages; frame++)
+			if (!frameTable->Entry(frame)->queued
+			    || frameTable->Entry(frame)->space == NULL)
+				frames[n++] = frame;	// free, or kept by the
+							// page cache
+	} else {
+		for (; n < NumPhysPages; n++)
+			frames[n] = (clockHand + n) % NumPhysPages;
+	}
+}
 
 // Begin code changes by Chet Ransonet
 
 // called in the case of a PageFaultException
 // loads code and data into a free physical page if there is one
+//
+// A page read from swap takes a while to arrive.  The thread waits
+// for it, and other threads run; pages being prefetched keep coming
+// in after it returns.  A fault on a page that is already on its way
+// in just waits for it.  The thread may also sleep before it has a
+// frame for the page -- suspended by load control, or writing out a
+// victim -- and another thread of the process may fault on the page
+// meanwhile, so the page is looked at again after each.
+//
+// A page of code may be in the page cache, and need no frame of its
+// own.  Otherwise, with no free frame, an unused frame the page cache
+// is keeping is taken before anything is evicted.
 
 
 
@@ -215,17 +482,27 @@ void AddrSpace::loadPage(int badVAddr)
 	printf("\nPage Fault: \n");
 
 	stats->numPageFaults++;
-
 	int virtualPage = badVAddr / PageSize, physPage;
-	unsigned int pageStart, offset, size; //modifiers for copying data into memory
-	bool lock = false;
-	
-   	//loadThreadIntoIPT(virtualPage);
 
+	if (swapChoice == 5)
+		ControlLoad();
+	if (pageTable[virtualPage].physicalPage != -1)
+	{
+		stats->numPageInWaits++;
+		frameTable->WaitForTransfer(pageTable[virtualPage].physicalPage);
+		return;
+	}
+	if (MapCached(virtualPage))
+		return;
+	
 	printf("Page availability before adding the process: \n");
 	memMap->Print();	
 
-	physPage = memMap->Find(); // select a physical page not in use
+	// select a physical page not in use, zeroed if the page starts
+	// out zeroed (or partly so)
+	physPage = frameTable->FindFree(swapSlot[virtualPage] == -1);
+	if (physPage == -1)	// then a frame the page cache can spare
+		physPage = pageCache->Reclaim();
 	//printf("Phys page initial = %d\n", physPage);
 	if (physPage == -1) //if no page was found, swap out a page
 	{
@@ -233,7 +510,7 @@ void AddrSpace::loadPage(int badVAddr)
 		{
 			//Begin code changes by Ben Matkin and Stephen Mader
 			printf("Out of memory, swapping pages using FIFO page replacement\n");
-			physPage = (int)pageList->Remove(); // Take one page off front of list
+			physPage = FIFOVictim(); // Take one page off front of list
 			printf("physPage = %d \n", physPage);
 			//End code changes by Ben Matkin and Stephen Mader
 			
@@ -241,30 +518,59 @@ void AddrSpace::loadPage(int badVAddr)
 		else if (swapChoice == 2) // Random
 		{
 			printf("Out of memory, swapping pages using Random page replacement\n");
-			physPage = Random() % 32;
+			if (frameTable->AllPinned())
+				physPage = -1;
+			else do
+				physPage = Random() % NumPhysPages;
+			while (frameTable->IsPinned(physPage));
 			//printf("physPage = %d \n", physPage);	
 		}
+		else if (swapChoice == 3) // Clock
+		{
+			printf("Out of memory, swapping pages using Clock page replacement\n");
+			physPage = ClockVictim(FALSE);
+		}
+		else if (swapChoice == 4) // Enhanced second chance
+		{
+			printf("Out of memory, swapping pages using Enhanced Second-Chance page replacement\n");
+			physPage = ClockVictim(TRUE);
+		}
+		else if (swapChoice == 5) // Working set
+		{
+			printf("Out of memory, swapping pages using WSClock page replacement\n");
+			physPage = WSClockVictim();
+		}
 		else // default
 		{
 			printf("Out of memory, virtual memory scheme not selected, exiting...\n");
 			ASSERT(false); 
 		}
 		
-		
-	
-		if(!ipt[physPage]->space->Swapout(physPage))
+		if (physPage == -1)	// every frame is being paged
+		{
+			frameTable->WaitForUnpin();
+			return;		// and fault again
+		}
+		frameTable->Pin(physPage);	// until its new page is in
+		if(!frameTable->Entry(physPage)->space->Swapout(physPage))
 			return;
+		if (pageTable[virtualPage].physicalPage != -1)
+		{	// brought in while the victim was written: give
+			// its frame back
+			frameTable->Unpin(physPage);
+			memMap->Clear(physPage);
+			stats->numPageInWaits++;
+			frameTable->WaitForTransfer(pageTable[virtualPage].physicalPage);
+			return;
+		}
 			
 		printf("Process %i request VPN %i.\n", currentThread->getID(), virtualPage);
 		
 	}
-		if(swapChoice == 1)
-		{
-			pageList->Append((int *) physPage); // Store virtual page, though mainly just maintaining index cue
-			lock = true;
-			pageLock[physPage]->P();
-		}
-	ipt[physPage] = currentThread;
+	else
+		frameTable->Pin(physPage);
+	frameTable->Map(physPage, this, virtualPage);
+	machine->InvalidateFrame(physPage);	// frame is about to be refilled
 		
 	//printf("Assigning frame %i \n", physPage);
 	pageTable[virtualPage].physicalPage = physPage;
@@ -275,74 +581,294 @@ void AddrSpace::loadPage(int badVAddr)
 	//debugging
 	printf("Page that faulted: %i\nPhysical page selected: %i\n", virtualPage, physPage);
 	
-	if(!swapped[virtualPage])
-	{
-		bzero(machine->mainMemory + PageSize * physPage, PageSize);
-		
-		pageStart = 0; //starting place to load in code/data
-		offset = 0;	//modifies the location we're reading from
+	pageCleaner->Check();
+	pageMerger->Check();
+	PageIn(virtualPage, physPage);
+	Prefetch(virtualPage);
+	frameTable->WaitForTransfer(physPage);
+    return;
+}
 
-		// code segment
-		if (noffH.code.size > 0)
-		{
-			if (noffH.code.virtualAddr <= virtualPage * PageSize)
-				offset = virtualPage * PageSize - noffH.code.virtualAddr;
-			else 
-				pageStart = noffH.code.virtualAddr - virtualPage * PageSize;		
-			
-			// set size of data to be copied
-			size = PageSize - pageStart;
-			if (noffH.code.virtualAddr + noffH.code.size < (virtualPage+1) * PageSize)
-				size -= (virtualPage) * PageSize - (noffH.code.virtualAddr + noffH.code.size);
-				
-			// copy data to memory	
-			file->ReadAt(&(machine->mainMemory[PageSize * physPage + pageStart]),
-			 	size, 
-			 	noffH.code.inFileAddr + offset);
-			 		 
-			//file->ReadAt(&data + pageStart,size,noffH.code.inFileAddr + offset);
-			 
-		}
-		
-		pageStart = 0;
-		offset = 0;
-		
-		// initData segment
-		if (noffH.initData.size > 0)
-		{
-			if (noffH.initData.virtualAddr <= virtualPage * PageSize)
-				offset = virtualPage * PageSize - noffH.initData.virtualAddr;
-			else
-				pageStart = noffH.initData.virtualAddr - virtualPage * PageSize;
-			
-			//set size of data to be copied
-			size = PageSize - pageStart;
-			if (noffH.initData.virtualAddr + noffH.initData.size < (virtualPage+1) * PageSize)
-				size -= (virtualPage) * PageSize - (noffH.initData.virtualAddr + noffH.initData.size);
-				
-			//copy data into memory
-			file->ReadAt(&(machine->mainMemory[PageSize * physPage+pageStart]) , 
-				size, 
-				noffH.initData.inFileAddr + offset);
-			//file->ReadAt(data, size, noffH.initData.inFileAddr + offset);
-		}
-		
-		char * data = machine->mainMemory + physPage * PageSize;
-		swapFile->WriteAt(data, PageSize, virtualPage * PageSize);
+//----------------------------------------------------------------------
+// AddrSpace::Prefetch
+// 	After a fault on "virtualPage", bring in the pages that follow
+//	it in the same segment too, so that a program running through
+//	its code or data a page at a time does not fault on every page.
+//	Only free frames are used: nothing is evicted to make room.
+//
+//	How many pages are brought in adapts to the faults.  A fault on
+//	the page just past an earlier window means we are being read
+//	sequentially, and the window doubles (up to prefetchPages); any
+//	other fault halves it, and starts a new sequence.  The last
+//	PrefetchStreams sequences are followed, since a program often
+//	runs through several arrays at once.
+//
+//	Prefetched pages are mapped with their use bit clear, so we can
+//	tell later whether they were used (see RetirePrefetch).  Pages
+//	read from swap are not waited for.
+//----------------------------------------------------------------------
 
-		pageTable[virtualPage].valid = true;
-		pageTable[virtualPage].dirty = false;
-		
-		
+void AddrSpace::Prefetch(int virtualPage)
+{
+	int last, frame, stream;
+
+	for (stream = 0; stream < PrefetchStreams; stream++)
+		if (nextSequential[stream] == virtualPage)
+			break;
+	if (stream < PrefetchStreams)
+		prefetchWindow = (prefetchWindow == 0) ? 1 : 2 * prefetchWindow;
+	else {
+		prefetchWindow /= 2;
+		stream = nextStream;
+		nextStream = (nextStream + 1) % PrefetchStreams;
+	}
+	if (prefetchWindow > prefetchPages)
+		prefetchWindow = prefetchPages;
+	last = virtualPage + prefetchWindow;
+	if (last > SegmentEnd(virtualPage))
+		last = SegmentEnd(virtualPage);
+	nextSequential[stream] = last + 1;
+
+	for (int page = virtualPage + 1; page <= last; page++) {
+		if (pageTable[page].physicalPage != -1 || MapCached(page))
+			continue;		// already in, or on its way
+		if ((frame = frameTable->FindFree(swapSlot[page] == -1)) == -1)
+			break;
+		frameTable->Pin(frame);
+		frameTable->Map(frame, this, page);
+		machine->InvalidateFrame(frame);
+		pageTable[page].physicalPage = frame;
+		pageTable[page].use = FALSE;
+		prefetched[page] = TRUE;
+		stats->numPrefetches++;
+		PageIn(page, frame);
 	}
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SegmentEnd
+// 	Return the last page of the segment "virtualPage" is in: the
+//	code, the initialized data, or the rest of the address space
+//	(uninitialized data and the stack).
+//----------------------------------------------------------------------
+
+int AddrSpace::SegmentEnd(int virtualPage)
+{
+	int address = virtualPage * PageSize;
+
+	if (noffH.code.size > 0 && address >= noffH.code.virtualAddr
+	    && address < noffH.code.virtualAddr + noffH.code.size)
+		return (noffH.code.virtualAddr + noffH.code.size - 1) / PageSize;
+	if (noffH.initData.size > 0 && address >= noffH.initData.virtualAddr
+	    && address < noffH.initData.virtualAddr + noffH.initData.size)
+		return (noffH.initData.virtualAddr + noffH.initData.size - 1)
+			/ PageSize;
+	return numPages - 1;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::RetirePrefetch
+// 	A page is being evicted, or we are going away, or its use bit is
+//	about to be cleared.  If it was prefetched, count whether it was
+//	used since -- a prefetch hit -- or not -- a wasted prefetch.
+//	Either way, it is an ordinary page from now on.
+//
+//	With a TLB, the page's TLB entry must have been written back.
+//----------------------------------------------------------------------
+
+void AddrSpace::RetirePrefetch(int virtualPage)
+{
+	if (!prefetched[virtualPage])
+		return;
+	if (pageTable[virtualPage].use || pageTable[virtualPage].dirty)
+		stats->numPrefetchHits++;
 	else
+		stats->numPrefetchesWasted++;
+	prefetched[virtualPage] = FALSE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ClearUse
+// 	Clear the use bit of one of our pages, to see whether it is used
+//	again.  A prefetched page gets the credit for its first use.
+//----------------------------------------------------------------------
+
+void AddrSpace::ClearUse(int virtualPage)
+{
+	if (pageTable[virtualPage].use)
+		RetirePrefetch(virtualPage);
+	pageTable[virtualPage].use = FALSE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PageIn
+// 	Fill a frame with one of our pages.  If the page has a swap
+//	slot, it comes from there.  Otherwise the page has never been
+//	modified, and is built the way the program starts out: zeroed,
+//	with whatever parts of the code and initialized data segments
+//	are on it read from the executable.  Pages of uninitialized data
+//	and stack have nothing to read, and need no I/O at all.  If the
+//	frame is already zeroed (see FrameTable::FindFree), it need not
+//	be cleared.  If the executable is laid out page by page (by
+//	coff2noff -a), the page is read whole, in a single read, and
+//	only what is past the end of the file is cleared.  A page of
+//	nothing but code is entered in the page cache, read-only.
+//
+//	The frame is unpinned once the page is in.  A page from swap is
+//	not in yet when we return: see Swapin.
+//
+//	"virtualPage" -- the page
+//	"physPage" -- the frame, already given to the page, and pinned
+//----------------------------------------------------------------------
+
+void AddrSpace::PageIn(int virtualPage, int physPage)
+{
+	bool zeroed = frameTable->UseZeroed(physPage);
+	int read;
+
+	if(swapSlot[virtualPage] != -1)
+	{
 		Swapin(virtualPage, physPage);
-	if(lock)
+		return;
+	}
+
+	if(noffH.noffMagic & NOFFALIGNED)
 	{
-		pageLock[physPage]->V();
-		lock = false;
+		read = ReadPage(virtualPage, physPage);
+		if(!zeroed)
+			bzero(machine->mainMemory + PageSize * physPage + read,
+				PageSize - read);
 	}
-    return;
+	else
+	{
+		if(!zeroed)
+			bzero(machine->mainMemory + PageSize * physPage, PageSize);
+		read = ReadSegment(&noffH.code, virtualPage, physPage)
+		    + ReadSegment(&noffH.initData, virtualPage, physPage);
+	}
+	if(zeroed)
+		stats->numZeroedFramesUsed++;
+	if(read == 0)
+		stats->numZeroFills++;
+	if (pageCache->Enabled() && CodePage(virtualPage)
+	    && pageCache->Find(program, virtualPage) == -1)
+	{
+		pageCache->Enter(physPage, program, virtualPage);
+		pageTable[virtualPage].readOnly = true;
+		stats->numPageCacheFills++;
+	}
+	pageTable[virtualPage].valid = true;
+	pageTable[virtualPage].dirty = false;
+	frameTable->Unpin(physPage);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ReadSegment
+// 	Read the part of a segment that is on one of our pages from the
+//	executable, into the page's frame.
+//
+//	"segment" -- the code or initialized data segment
+//	"virtualPage" -- the page
+//	"physPage" -- its frame
+//
+// Returns:
+//	How many bytes of the segment are on the page.
+//----------------------------------------------------------------------
+
+int AddrSpace::ReadSegment(Segment *segment, int virtualPage, int physPage)
+{
+	int pageAddr = virtualPage * PageSize;
+	int start = max(segment->virtualAddr, pageAddr);
+	int end = min(segment->virtualAddr + segment->size, pageAddr + PageSize);
+
+	if (start >= end)
+		return 0;
+	file->ReadAt(&machine->mainMemory[physPage * PageSize + start - pageAddr],
+		end - start, segment->inFileAddr + start - segment->virtualAddr);
+	return end - start;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ReadPage
+// 	Read one of our pages from an executable laid out by coff2noff -a,
+//	in which every page of the code and initialized data is a whole,
+//	aligned block of the file, zeros between the segments included.
+//	Pages past the end of the initialized data are not read at all.
+//
+//	"virtualPage" -- the page
+//	"physPage" -- its frame
+//
+// Returns:
+//	How many bytes were read, from the start of the page; the rest
+//	is past the end of the file.
+//----------------------------------------------------------------------
+
+int AddrSpace::ReadPage(int virtualPage, int physPage)
+{
+	int pageAddr = virtualPage * PageSize;
+	int end = 0, offset = 0;
+
+	if (noffH.code.size > 0) {
+		end = noffH.code.virtualAddr + noffH.code.size;
+		offset = noffH.code.inFileAddr - noffH.code.virtualAddr;
+	}
+	if (noffH.initData.size > 0) {
+		end = max(end, noffH.initData.virtualAddr + noffH.initData.size);
+		offset = noffH.initData.inFileAddr - noffH.initData.virtualAddr;
+	}
+	if (pageAddr >= end)
+		return 0;
+	return file->ReadAt(&machine->mainMemory[physPage * PageSize],
+		PageSize, offset + pageAddr);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CodePage
+// 	Say whether one of our pages holds nothing but code, and so is
+//	never written to, and can be shared through the page cache.
+//
+//	"virtualPage" -- the page
+//----------------------------------------------------------------------
+
+bool AddrSpace::CodePage(int virtualPage)
+{
+	int address = virtualPage * PageSize;
+
+	return noffH.code.size > 0 && address >= noffH.code.virtualAddr
+	    && address + PageSize <= noffH.code.virtualAddr + noffH.code.size;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::MapCached
+// 	If one of our pages is in the page cache, map it, read-only, to
+//	the cache's frame, which it shares with whoever else is using it.
+//	A page that has been written to swap has changed, and is never
+//	looked for.
+//
+//	"virtualPage" -- the page, which must not be mapped
+//
+// Returns:
+//	Whether the page was found.
+//----------------------------------------------------------------------
+
+bool AddrSpace::MapCached(int virtualPage)
+{
+	int frame;
+
+	if (swapSlot[virtualPage] != -1 || !CodePage(virtualPage)
+	    || (frame = pageCache->Find(program, virtualPage)) == -1)
+		return false;
+	if (frameTable->Entry(frame)->space == NULL) {
+		pageCache->Use(frame);
+		frameTable->Map(frame, this, virtualPage);
+	} else
+		frameTable->Share(frame, this, virtualPage);
+	pageTable[virtualPage].physicalPage = frame;
+	pageTable[virtualPage].valid = true;
+	pageTable[virtualPage].readOnly = true;
+	pageTable[virtualPage].dirty = false;
+	stats->numPageCacheHits++;
+	return true;
 }
 
 // End code changes by Chet Ransonet
@@ -357,28 +883,75 @@ void AddrSpace::loadPage(int badVAddr)
 
 AddrSpace::~AddrSpace()
 {
+	AddrSpace **prev;
+	bool waited;
+
+	// A prefetch, or the page cleaner, may still be using our frames.
+	// The cleaner may start on another while we wait, so look again
+	// until there is nothing to wait for.
+	do {
+		waited = FALSE;
+		for(unsigned int i = 0; i < numPages; i++)
+		{
+			int frame = pageTable[i].physicalPage;
+
+			if(frame != -1 && frameTable->Entry(frame)->inTransit)
+			{
+				frameTable->WaitForTransfer(frame);
+				waited = TRUE;
+			}
+		}
+	} while (waited);
+	for (prev = &allSpaces; *prev != this; prev = &(*prev)->nextSpace)
+		;
+	*prev = nextSpace;
+	if (wsSamples > 0)
+		stats->RecordWorkingSet(currentThread->getID(),
+			wsTotal / wsSamples, wsPeak, suspensions);
+
 	// Only clear the memory if it was set to begin with
 	// which in turn only happens after space is set to true
 
 	if(space)
 	{
+		FlushTLB();
+		if(machine->tlb != NULL && asidGeneration == currentGeneration)
+			asidOwner[asid] = NULL;
+		if(tlbSpace == this)
+			tlbSpace = NULL;
 		for(unsigned int i = 0; i < numPages; i++)	
 		{
-			if(pageTable[i].physicalPage != -1)
-				memMap->Clear(pageTable[i].physicalPage);
+			RetirePrefetch(i);
+			if(pageTable[i].physicalPage != -1
+			   && !frameTable->Unshare(pageTable[i].physicalPage, this, i))
+			{
+				frameTable->Unmap(pageTable[i].physicalPage);
+				if(!pageCache->Release(pageTable[i].physicalPage))
+					memMap->Clear(pageTable[i].physicalPage);
+			}
 		}
 		delete pageTable;
+		machine->FlushTranslations();
 		
 		memMap->Print();
 	}
 	
-	delete file;
-	
+	if(--(*fileUsers) == 0)
+	{
+		delete file;
+		delete fileUsers;
+	}
 	
-	//Begin code changes by Ryan Mazerole
-	DestroySwapFile();
-	//End code changes by Ryan Mazerole
+	for(unsigned int i = 0; i < numPages; i++)
+		if(swapSlot[i] != -1)
+			swapDevice->FreeSlot(swapSlot[i]);
 	// End code changes by Chet Ransonet
+	delete [] swapSlot;
+	delete [] lastUse;
+	delete [] prefetched;
+	pageCache->Forget(program);
+	
+	ResumeProcess(FALSE);		// our memory may let someone run
 }
 
 //----------------------------------------------------------------------
@@ -418,100 +991,822 @@ AddrSpace::InitRegisters()
 // 	On a context switch, save any machine state, specific
 //	to this address space, that needs saving.
 //
-//	For now, nothing!
+//	Even with a TLB, our translations can stay in it, tagged with
+//	our ASID.  All we do is stop our virtual time.
 //----------------------------------------------------------------------
 
 void AddrSpace::SaveState() 
-{}
+{
+    if (running) {
+	virtualTime += stats->userTicks - runStart;
+	running = FALSE;
+    }
+}
 
 //----------------------------------------------------------------------
 // AddrSpace::RestoreState
 // 	On a context switch, restore the machine state so that
 //	this address space can run.
 //
-//      For now, tell the machine where to find the page table.
+//      For now, tell the machine where to find the page table.  With
+//	a TLB, the machine doesn't look at page tables: the kernel
+//	loads our translations into the TLB as they are missed.  The
+//	machine just needs our ASID, which we may have to be given.
+//
+//	Our virtual time starts again.
 //----------------------------------------------------------------------
 
 void AddrSpace::RestoreState() 
 {
-    machine->pageTable = pageTable;
+    if (!running) {
+	runStart = stats->userTicks;
+	running = TRUE;
+    }
+    if (machine->tlb != NULL) {
+	if (asidGeneration != currentGeneration)
+	    AssignASID();
+	if (tlbSpace != this) {
+	    tlbSpace = this;
+	    stats->numTLBSwitches++;
+	}
+	machine->asid = asid;
+	machine->pageTable = NULL;
+    } else
+	machine->pageTable = pageTable;
     machine->pageTableSize = numPages;
+    machine->FlushTranslations();
 }
 
-//Begin code changes by Ryan Mazerole
-void AddrSpace::Swap(int pageNum){
+//----------------------------------------------------------------------
+// AddrSpace::AssignASID
+// 	Give this address space an ASID no other address space has in
+//	the current generation.  If they are all taken, start a new
+//	generation: every address space's ASID becomes stale, so all
+//	the TLB's entries go, and each address space gets a new ASID
+//	the next time it runs.
+//
+//	The ASID of an address space that is deleted is given back,
+//	and its TLB entries dropped then, so an ASID that is handed out
+//	never has stale entries in the TLB.
+//----------------------------------------------------------------------
 
-	sprintf(swapfilename, "%d.swap", currentThread->getID());
+void AddrSpace::AssignASID()
+{
+    int i;
 
-	fileSystem->Create(swapfilename, pageNum * PageSize);
-	swapFile = fileSystem->Open(swapfilename);
-	
+    for (i = 0; i < tlbAsids && asidOwner[i] != NULL; i++)
+	;
+    if (i == tlbAsids) {
+	DEBUG('a', "Out of ASIDs, starting generation %d\n",
+		currentGeneration + 1);
+	for (int e = 0; e < machine->tlbSize; e++)
+	    if (machine->tlb[e].valid)
+		SaveTLBEntry(e);
+	for (i = 0; i < tlbAsids; i++)
+	    asidOwner[i] = NULL;
+	currentGeneration++;
+	i = 0;
+    }
+    asid = i;
+    asidGeneration = currentGeneration;
+    asidOwner[asid] = this;
 }
 
-void AddrSpace::DestroySwapFile(){
-	
-	delete swapFile;
-	fileSystem->Remove(swapfilename);
+//----------------------------------------------------------------------
+// AddrSpace::SaveTLBEntry
+// 	The hardware only sets the use and dirty bits in the TLB's copy
+//	of a translation.  Copy them back into the page table of the
+//	address space the entry belongs to, and drop the TLB entry.
+//
+//	"entry" -- the index of a valid TLB entry
+//----------------------------------------------------------------------
+
+void AddrSpace::SaveTLBEntry(int entry)
+{
+    TranslationEntry *tlbEntry = &machine->tlb[entry];
+    AddrSpace *owner = asidOwner[tlbEntry->asid];
+    TranslationEntry *pte;
+
+    ASSERT(tlbEntry->valid && owner != NULL);
+    pte = &owner->pageTable[tlbEntry->virtualPage];
+    ASSERT(pte->physicalPage == tlbEntry->physicalPage);
+    pte->use = pte->use || tlbEntry->use;
+    pte->dirty = pte->dirty || tlbEntry->dirty;
+    tlbEntry->valid = FALSE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FlushTLB
+// 	Save and drop all of our TLB entries.
+//----------------------------------------------------------------------
+
+void AddrSpace::FlushTLB()
+{
+    if (machine->tlb == NULL || asidGeneration != currentGeneration)
+	return;
+    for (int i = 0; i < machine->tlbSize; i++)
+	if (machine->tlb[i].valid && machine->tlb[i].asid == asid)
+	    SaveTLBEntry(i);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FlushTLBPage
+// 	Save and drop the TLB entry for one of our pages, if there is
+//	one, before its page table entry is changed.
+//
+//	"virtualPage" -- the page whose translation is changing
+//----------------------------------------------------------------------
+
+void AddrSpace::FlushTLBPage(int virtualPage)
+{
+    int entry;
+
+    if (machine->tlb == NULL || asidGeneration != currentGeneration)
+	return;
+    entry = machine->TLBLookup(virtualPage, asid);
+    if (entry >= 0)
+	SaveTLBEntry(entry);
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::VirtualTime
+// 	Return how many user instructions this process has executed.
+//	Working sets are measured in this time, so that a process
+//	waiting for the CPU does not lose its pages for not using them.
+//----------------------------------------------------------------------
+
+int AddrSpace::VirtualTime()
+{
+    if (running)
+	return virtualTime + stats->userTicks - runStart;
+    return virtualTime;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PageAge
+// 	Return how long it has been, in our virtual time, since one of
+//	our pages was used.  The hardware only sets a use bit, so the
+//	time is when the use bit was last seen set; it is then cleared,
+//	to see if the page is used again.  With a TLB, the use bit may
+//	be set in the page's TLB entry instead.
+//
+//	"virtualPage" -- the page
+//----------------------------------------------------------------------
+
+int AddrSpace::PageAge(int virtualPage)
+{
+    TranslationEntry *entry = &pageTable[virtualPage];
+    int now = VirtualTime(), tlbEntry;
+
+    if (machine->tlb != NULL && asidGeneration == currentGeneration) {
+	tlbEntry = machine->TLBLookup(virtualPage, asid);
+	if (tlbEntry >= 0 && machine->tlb[tlbEntry].use) {
+	    machine->tlb[tlbEntry].use = FALSE;
+	    entry->use = TRUE;
+	}
+    }
+    if (entry->use) {
+	ClearUse(virtualPage);
+	lastUse[virtualPage] = now;
+    }
+    return now - lastUse[virtualPage];
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::WorkingSetSize
+// 	Return how many of our pages have been used in the last
+//	WSWindow of our virtual time.  Pages that have been evicted
+//	count too: when memory is overcommitted, pages in working sets
+//	are evicted, and that is just when the size matters.
+//----------------------------------------------------------------------
+
+int AddrSpace::WorkingSetSize()
+{
+    int size = 0, now = VirtualTime(), age;
+
+    for (unsigned int i = 0; i < numPages; i++) {
+	if (pageTable[i].valid)
+	    age = PageAge(i);
+	else
+	    age = now - lastUse[i];
+	if (age <= WSWindow)
+	    size++;
+    }
+    return size;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ActiveDemand
+// 	Return how many pages the working sets of all the processes
+//	that are not suspended add up to.
+//----------------------------------------------------------------------
+
+int AddrSpace::ActiveDemand()
+{
+    int demand = 0;
+
+    for (AddrSpace *space = allSpaces; space != NULL; space = space->nextSpace)
+	if (!space->suspended)
+	    demand += space->WorkingSetSize();
+    return demand;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ControlLoad
+// 	The page fault frequency load controller, called at each of our
+//	page faults with working set replacement.
+//
+//	If we are faulting more often than once every PFFInterval, we
+//	need more pages than we have.  If the working sets of the
+//	processes that are running already fill memory, there are no
+//	more to give, and the processes would only steal each other's
+//	pages: so we are suspended, until there is room for our working
+//	set again (see ResumeProcess).  Our pages are then the first to
+//	go.  We are never suspended if no other process is running.
+//
+//	Otherwise, a suspended process may fit again.
+//----------------------------------------------------------------------
+
+void AddrSpace::ControlLoad()
+{
+    int now = VirtualTime(), size = WorkingSetSize(), demand;
+    bool faultingOften = (now - lastFault < PFFInterval);
+    AddrSpace *other;
+    IntStatus oldLevel;
+
+    lastFault = now;
+    wsSamples++;
+    wsTotal += size;
+    if (size > wsPeak)
+	wsPeak = size;
+
+    if (faultingOften && (demand = ActiveDemand()) > NumPhysPages) {
+	for (other = allSpaces; other != NULL; other = other->nextSpace)
+	    if (other != this && !other->suspended)
+		break;
+	if (other != NULL) {
+	    printf("Process %i suspended: working sets need %d pages.\n",
+		currentThread->getID(), demand);
+	    oldLevel = interrupt->SetLevel(IntOff);
+	    suspended = TRUE;
+	    suspendedSize = size;
+	    suspensions++;
+	    stats->numSuspensions++;
+	    suspendedThreads->Append((void *) currentThread);
+	    currentThread->Sleep();		// until ResumeProcess
+	    (void) interrupt->SetLevel(oldLevel);
+	    return;
+	}
+    }
+    ResumeProcess(FALSE);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ResumeProcess
+// 	Resume the process that has been suspended longest, if its
+//	working set fits in the memory the running processes leave.
+//	Called when memory may have been freed: at page faults, and
+//	when a process exits.
+//
+//	"force" -- resume it anyway, because nothing else can run
+//
+// Returns:
+//	TRUE if a process was resumed.
+//----------------------------------------------------------------------
+
+bool AddrSpace::ResumeProcess(bool force)
+{
+    Thread *thread;
+    IntStatus oldLevel;
+
+    if (suspendedThreads->IsEmpty())
+	return FALSE;
+    oldLevel = interrupt->SetLevel(IntOff);
+    thread = (Thread *) suspendedThreads->Remove();
+    if (!force
+	&& ActiveDemand() + thread->space->suspendedSize > NumPhysPages) {
+	suspendedThreads->Prepend((void *) thread);
+	(void) interrupt->SetLevel(oldLevel);
+	return FALSE;
+    }
+    printf("Process %i resumed.\n", thread->getID());
+    thread->space->suspended = FALSE;
+    scheduler->ReadyToRun(thread);
+    (void) interrupt->SetLevel(oldLevel);
+    return TRUE;
+}
+
+//Begin code changes by Ryan Mazerole
+
+//----------------------------------------------------------------------
+// SwapinDone
+// 	Called by the swap device's interrupt handler when a page has
+//	been read into a frame.  The page can be used, the frame can be
+//	evicted again, and whoever is waiting for the page can run.
+//
+//	"frame" -- the frame
+//----------------------------------------------------------------------
+
+static void
+SwapinDone(int frame)
+{
+	FrameEntry *entry = frameTable->Entry(frame);
+	TranslationEntry *pte =
+		entry->space->getPageTableEntry(entry->virtualPage);
+
+	pte->valid = true;
+	pte->dirty = false;
+	frameTable->FinishTransfer(frame);
+	frameTable->Unpin(frame);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Swapin
+// 	Start reading one of our pages from its swap slot into a frame,
+//	and return without waiting for it: the frame is in transit (see
+//	frametable.h) until SwapinDone.
+//
+//	"page" -- the page, which must have a swap slot
+//	"frame" -- the frame, already given to the page, and pinned
+//----------------------------------------------------------------------
+
 bool AddrSpace::Swapin(int page, int frame)
 {
 		
-	ASSERT(page >= 0);
+	ASSERT(page >= 0 && swapSlot[page] != -1);
 	ASSERT(frame >= 0 && frame < NumPhysPages);
 
-	//AddrSpace * space = currentThread->space;
-
-	int characterRead;
 	char *position = machine->mainMemory + frame * PageSize;
 
-	characterRead = swapFile->ReadAt(position, PageSize, page * PageSize);
+	stats->numSwapReads++;
+	frameTable->StartTransfer(frame);
+	swapDevice->StartRead(swapSlot[page], position, SwapinDone, frame);
 
-	bool check = (characterRead == PageSize);
+	return true;
 
-	if(check){
-		setValidity(page, true);
-		setDirty(page, false);
-	}
-	
-	swapped[page] = true;
+}
 
-	return check;
+//----------------------------------------------------------------------
+// Swap-out clustering.  Writing a page costs a seek and a rotational
+// delay, besides the transfer, so a dirty victim is not written out
+// alone: the dirty pages next to it in its address space that are
+// not in use (see ClusterCandidate) go with it, to consecutive swap
+// slots, in one request.  They are likely to be the next victims,
+// but they are left mapped, just no longer dirty, so that they can
+// be dropped without a write when their turn comes.  (Evicting them
+// at once costs more than it saves: too many of them are faulted
+// back in.)
+//
+// How many pages go at once adapts to memory pressure.  A dirty
+// eviction less than ClusterInterval ticks after the one before
+// means memory is being reused quickly, and the cluster doubles (up
+// to swapCluster pages); otherwise it halves, down to the victim
+// alone.
+//----------------------------------------------------------------------
 
-}
+static int clusterSize = 1;		// the most pages to write at the next
+					// dirty eviction
+static int lastDirtyEviction = -ClusterInterval;
+					// totalTicks at the last one
+
+//----------------------------------------------------------------------
+// AddrSpace::Swapout
+// 	Evict the page in one of our frames.  A dirty page is written to
+//	its swap slot, which it is given the first time; a clean page is
+//	just dropped, since it is the same as its swap slot's copy, or if
+//	it has none, it can be rebuilt from the executable.  A dirty page
+//	may have some of its neighbours written with it (see above); they
+//	are all given new, consecutive slots, since their old copies are
+//	out of date anyway.
+//
+//	The victim is unmapped before it is written, so that nobody can
+//	change it while the thread waits for the disk.  Its neighbours
+//	have their dirty bits cleared first, as in StartClean, and are in
+//	transit until the write is done.  By the time it is done, we may
+//	even have gone away (our slots are then freed, and the write is
+//	wasted); nothing of ours is touched after it.
+//
+//	A frame that other pages share is evicted by SwapoutShared.  The
+//	frame is to be given to another page, so if it is in the page
+//	cache, it leaves it.
+//
+//	"frame" -- the frame, which must be pinned
+//----------------------------------------------------------------------
 
 bool AddrSpace::Swapout(int frame)
 {
-	int virtPage = -1;
-	for(unsigned int i=0; i < numPages; i++)
+	int virtPage = frameTable->Entry(frame)->virtualPage;
+	int first, last, count, slot, page;
+	int frames[NumPhysPages];
+	char *pages[NumPhysPages];
+	
+	if(frameTable->Entry(frame)->space != this
+	   || pageTable[virtPage].physicalPage != frame)
 	{
-		if(pageTable[i].physicalPage == frame)
-		{
-			virtPage = i; //printf("virtPage = %i\n", virtPage);
+		printf("\n\nERROR: Page could not be swapped!\n\n\n");
+		ASSERT(false);
+		//return false;
+	}
+
+	pageCache->Drop(frame);
+	if(frameTable->IsShared(frame))
+	{
+		SwapoutShared(frame);
+		return true;
+	}
+	FlushTLBPage(virtPage);
+	if(!pageTable[virtPage].dirty)
+	{
+		Unload(virtPage);
+		machine->FlushTranslations();	// it may be the running space's
+		return true;
+	}
+
+	if(stats->totalTicks - lastDirtyEviction < ClusterInterval)
+		clusterSize = min(2 * clusterSize, swapCluster);
+	else
+		clusterSize = max(clusterSize / 2, 1);
+	lastDirtyEviction = stats->totalTicks;
+
+	first = last = virtPage;
+	while(last - first + 1 < clusterSize)
+	{
+		if(ClusterCandidate(last + 1))
+			page = ++last;
+		else if(ClusterCandidate(first - 1))
+			page = --first;
+		else
 			break;
+		frameTable->Pin(pageTable[page].physicalPage);
+	}
+	count = last - first + 1;
+
+	slot = -1;
+	if(count > 1)
+	{
+		for(page = first; page <= last; page++)
+			if(swapSlot[page] != -1)
+			{
+				swapDevice->FreeSlot(swapSlot[page]);
+				swapSlot[page] = -1;
+			}
+		slot = swapDevice->AllocateSlots(count);
+		if(slot == -1)		// no run that long: write the victim alone
+		{
+			for(page = first; page <= last; page++)
+				if(page != virtPage)
+					frameTable->Unpin(pageTable[page].physicalPage);
+			first = last = virtPage;
+			count = 1;
 		}
+		else
+			for(page = first; page <= last; page++)
+				swapSlot[page] = slot + page - first;
 	}
-	if(virtPage == -1)
+	if(count == 1)
+		slot = SwapSlot(virtPage);
+
+	for(page = first; page <= last; page++)
 	{
-		printf("\n\nERROR: Page could not be swapped!\n\n\n");
+		frames[page - first] = pageTable[page].physicalPage;
+		pages[page - first] =
+			machine->mainMemory + frames[page - first] * PageSize;
+		if(page == virtPage)
+			Unload(page);
+		else
+		{
+			setDirty(page, false);
+			frameTable->StartTransfer(frames[page - first]);
+		}
+	}
+	machine->FlushTranslations();	// it may be the running space's
+
+	stats->numSwapWrites += count;
+	stats->numDirtyEvictions++;
+	stats->numClusteredPages += count - 1;
+	swapDevice->WriteSlots(slot, count, pages);
+
+	for(int i = 0; i < count; i++)	// the victim's frame is the caller's
+		if(frames[i] != frame)
+		{
+			frameTable->FinishTransfer(frames[i]);
+			frameTable->Unpin(frames[i]);
+		}
+	return true;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ClusterCandidate
+//	Say whether one of our pages can be written out along with a
+//	dirty victim next to it: it must be in memory, not pinned, not
+//	sharing its frame, and dirty, and must not have been used since
+//	its use bit was last cleared.  (As with the page cleaner, under
+//	FIFO or random replacement, which never clear use bits, that
+//	means untouched since it was brought in.)
+//
+//	"virtualPage" -- the page, which may be outside the address space
+//----------------------------------------------------------------------
+
+bool AddrSpace::ClusterCandidate(int virtualPage)
+{
+	TranslationEntry *pte;
+	int frame;
+
+	if(virtualPage < 0 || virtualPage >= (int) numPages)
+		return false;
+	frame = pageTable[virtualPage].physicalPage;
+	if(frame == -1 || frameTable->IsPinned(frame)
+	   || frameTable->IsShared(frame))
+		return false;
+	pte = frameTable->PageTableEntry(frame);
+	return pte->dirty && !pte->use;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Unload
+// 	Take one of our pages out of its frame, leaving it to be brought
+//	back in at its next fault.  If other pages share the frame, it
+//	stays theirs.  The caller must flush the machine's cached
+//	translations.
+//
+//	"virtualPage" -- the page, which must be in memory
+//----------------------------------------------------------------------
+
+void AddrSpace::Unload(int virtualPage)
+{
+	int frame = pageTable[virtualPage].physicalPage;
+
+	FlushTLBPage(virtualPage);
+	RetirePrefetch(virtualPage);
+	pageTable[virtualPage].valid = false;
+	pageTable[virtualPage].dirty = false;
+	pageTable[virtualPage].readOnly = false;
+	pageTable[virtualPage].physicalPage = -1;
+	if(!frameTable->Unshare(frame, this, virtualPage))
+		frameTable->Unmap(frame);
+}
+
+//----------------------------------------------------------------------
+// CleanDone
+// 	Called by the swap device's interrupt handler when the page
+//	cleaner has written a page out.  Its frame can be evicted again.
+//
+//	"frame" -- the frame
+//----------------------------------------------------------------------
+
+static void
+CleanDone(int frame)
+{
+	frameTable->FinishTransfer(frame);
+	frameTable->Unpin(frame);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::StartClean
+// 	Start writing one of our dirty pages to its swap slot, leaving
+//	it mapped, so that it can later be evicted without waiting for
+//	a write.  The dirty bit is cleared first: if the page is changed
+//	before the write is done, it is dirty again, and the swap slot's
+//	copy is not used.  The frame stays pinned until the write is
+//	done, so that it is not refilled before the disk has the data.
+//
+//	"virtualPage" -- the page
+//	"physPage" -- its frame, which must not be pinned
+//----------------------------------------------------------------------
+
+void AddrSpace::StartClean(int virtualPage, int physPage)
+{
+	int slot = SwapSlot(virtualPage);
+
+	setDirty(virtualPage, false);
+	frameTable->Pin(physPage);
+	frameTable->StartTransfer(physPage);
+	stats->numSwapWrites++;
+	swapDevice->StartWrite(slot, machine->mainMemory + physPage * PageSize,
+		CleanDone, physPage);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::MergePage
+// 	Map one of our pages, read-only, to another frame that holds the
+//	same data (see pagemerger.h), and free the frame it was in.
+//
+//	"virtualPage" -- the page, which must be in an unpinned frame
+//	"frame" -- the frame to share
+//----------------------------------------------------------------------
+
+void AddrSpace::MergePage(int virtualPage, int frame)
+{
+	int oldFrame = pageTable[virtualPage].physicalPage;
+
+	FlushTLBPage(virtualPage);
+	frameTable->Unmap(oldFrame);
+	memMap->Clear(oldFrame);
+	pageTable[virtualPage].physicalPage = frame;
+	pageTable[virtualPage].readOnly = TRUE;
+	frameTable->Share(frame, this, virtualPage);
+	machine->FlushTranslations();
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SwapoutShared
+// 	Evict a frame that several pages share: all of them are taken out
+//	of it.  If they are all clean, and all have the same swap slot (or
+//	none, so that each is rebuilt from its executable), the frame is
+//	just dropped.  Otherwise it is written once, to a new slot that
+//	all of them share from then on, in place of their old ones.  As
+//	in Swapout, the pages are unmapped before the frame is written.
+//
+//	"frame" -- the frame, which must be pinned
+//----------------------------------------------------------------------
+
+void AddrSpace::SwapoutShared(int frame)
+{
+	FrameEntry *entry = frameTable->Entry(frame);
+	FrameSharer *sharer = entry->sharers;
+	AddrSpace *space = entry->space;
+	int page = entry->virtualPage;
+	int slot = space->swapSlot[page], newSlot = -1;
+	bool write = false;
+
+	for(;;)
+	{
+		space->FlushTLBPage(page);
+		if(space->pageTable[page].dirty || space->swapSlot[page] != slot)
+			write = true;
+		if(sharer == NULL)
+			break;
+		space = sharer->space;
+		page = sharer->virtualPage;
+		sharer = sharer->next;
+	}
+	if(write && (newSlot = swapDevice->AllocateSlot()) == -1)
+	{
+		printf("Out of swap space, exiting...\n");
 		ASSERT(false);
-		//return false;
 	}
 
-	if(pageTable[virtPage].dirty)
+	for(int users = 0; entry->space != NULL; users++)
 	{
-		char * data = machine->mainMemory + frame * PageSize;
-		swapFile->WriteAt(data, PageSize, virtPage * PageSize);
+		space = entry->space;
+		page = entry->virtualPage;
+		if(write)
+		{
+			if(space->swapSlot[page] != -1)
+				swapDevice->FreeSlot(space->swapSlot[page]);
+			space->swapSlot[page] = newSlot;
+			if(users > 0)
+				swapDevice->ShareSlot(newSlot);
+		}
+		space->Unload(page);
+	}
+	machine->FlushTranslations();	// it may be the running space's
+
+	if(write)
+	{
+		stats->numSwapWrites++;
+		stats->numDirtyEvictions++;
+		swapDevice->WriteSlot(newSlot,
+			machine->mainMemory + frame * PageSize);
+	}
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyOnWrite
+// 	Called when a write to one of our pages fails because it is
+//	read-only, which a page only is when it has been sharing a frame:
+//	merged with another page, since a Fork, or through the page cache.
+//	If it still is, it is given its own copy, in a free frame if there
+//	is one.  If there is not, the page is left out of memory, to be
+//	brought back in at the next fault like any other; if it is dirty,
+//	or would be found in the page cache again, the copy is written to
+//	its swap slot first.  (The swap cache usually takes the copy, so
+//	that costs no I/O.)  If the page is the only one left in the
+//	frame, and the frame is not cached, it just becomes writable
+//	again.
+//
+//	"badVAddr" -- the address that was written to
+//
+// Returns:
+//	Whether the write can be tried again; FALSE if the page is not
+//	ours, or not one that was shared.
+//----------------------------------------------------------------------
+
+bool AddrSpace::CopyOnWrite(int badVAddr)
+{
+	unsigned int virtualPage = (unsigned) badVAddr / PageSize;
+	int frame, copy;
+	bool cached;
+
+	if(virtualPage >= numPages || !pageTable[virtualPage].valid
+	   || !pageTable[virtualPage].readOnly)
+		return false;
+	frame = pageTable[virtualPage].physicalPage;
+	FlushTLBPage(virtualPage);
+	pageTable[virtualPage].readOnly = FALSE;
+	cached = pageCache->Holds(frame);
+	if(!frameTable->IsShared(frame) && !cached)
+	{
+		machine->FlushTranslations();
+		return true;
 	}
-	
-	pageTable[virtPage].valid = false;
-	pageTable[virtPage].dirty = false;
-	pageTable[virtPage].physicalPage = -1;
-	
-	swapped[virtPage] = false;
-	
-	//savePageTableEntry(pageTable[frame], pageTable[frame].virtualPage);
 
+	stats->numCopiesOnWrite++;
+	frameTable->Pin(frame);		// until it has been copied
+	if(!frameTable->Unshare(frame, this, virtualPage))
+	{
+		frameTable->Unmap(frame);	// the page cache keeps it
+		(void) pageCache->Release(frame);
+	}
+	if((copy = frameTable->FindFree(FALSE)) != -1)
+	{
+		(void) frameTable->UseZeroed(copy);
+		frameTable->Map(copy, this, virtualPage);
+		machine->InvalidateFrame(copy);
+		memcpy(machine->mainMemory + copy * PageSize,
+			machine->mainMemory + frame * PageSize, PageSize);
+		pageTable[virtualPage].physicalPage = copy;
+		machine->FlushTranslations();
+		frameTable->Unpin(frame);
+		return true;
+	}
+
+	RetirePrefetch(virtualPage);
+	pageTable[virtualPage].valid = FALSE;
+	pageTable[virtualPage].physicalPage = -1;
+	machine->FlushTranslations();
+	if(pageTable[virtualPage].dirty || cached)
+	{
+		pageTable[virtualPage].dirty = FALSE;
+		stats->numSwapWrites++;
+		swapDevice->WriteSlot(SwapSlot(virtualPage),
+			machine->mainMemory + frame * PageSize);
+	}
+	frameTable->Unpin(frame);
 	return true;
 }
+
+//----------------------------------------------------------------------
+// AddrSpace::SwapSlot
+// 	Return the swap slot to write one of our pages to, giving the
+//	page one the first time it is written out.  A page sharing its
+//	slot with others (see swapdevice.h) is given one of its own.
+//
+//	"virtualPage" -- the page
+//----------------------------------------------------------------------
+
+int AddrSpace::SwapSlot(int virtualPage)
+{
+	if(swapSlot[virtualPage] != -1
+	   && swapDevice->IsShared(swapSlot[virtualPage]))
+	{
+		swapDevice->FreeSlot(swapSlot[virtualPage]);
+		swapSlot[virtualPage] = -1;
+	}
+	if(swapSlot[virtualPage] == -1)
+	{
+		swapSlot[virtualPage] = swapDevice->AllocateSlot();
+		if(swapSlot[virtualPage] == -1)
+		{
+			printf("Out of swap space, exiting...\n");
+			ASSERT(false);
+		}
+	}
+	return swapSlot[virtualPage];
+}
 //End code changes by Ryan Mazerole
+
+//----------------------------------------------------------------------
+// AddrSpace::savePageTableEntry, setDirty, setValidity, setReadOnly
+// 	Edit one entry of the page table.  The machine may have cached
+//	a translation through the old entry, or have it in the TLB, so
+//	tell it to forget.
+//----------------------------------------------------------------------
+
+void AddrSpace::savePageTableEntry(TranslationEntry entry, int virtualPage)
+{
+	FlushTLBPage(virtualPage);
+	pageTable[virtualPage] = entry;
+	machine->FlushTranslations();
+}
+
+void AddrSpace::setDirty(int vpage, bool set)
+{
+	FlushTLBPage(vpage);
+	pageTable[vpage].dirty = set;
+	machine->FlushTranslations();
+}
+
+void AddrSpace::setValidity(int vpage, bool set)
+{
+	FlushTLBPage(vpage);
+	pageTable[vpage].valid = set;
+	machine->FlushTranslations();
+}
+
+void AddrSpace::setReadOnly(int vpage, bool set)
+{
+	FlushTLBPage(vpage);
+	pageTable[vpage].readOnly = set;
+	machine->FlushTranslations();
+}
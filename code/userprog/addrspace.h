@@ -19,12 +19,34 @@
 
 
 #define UserStackSize		1024 	// increase this as necessary!
+#define PrefetchPages		8	// by default, the most pages brought
+					// in after the one that faulted
+#define PrefetchStreams		4	// sequential runs of faults followed
+#define SwapCluster		8	// by default, the most pages written
+					// to swap together at an eviction
+#define ClusterInterval		5000	// dirty evictions closer together than
+					// this (in ticks) mean memory is tight
+
+// Working set replacement (-V 5).  Times are in user instructions
+// executed by the process itself.
+
+#define WSWindow		2000	// how long a page stays in the working
+					// set after it was last used
+#define PFFInterval		500	// a process that faults more often
+					// than this needs more memory
+
+class Profile;
 
 class AddrSpace {
   public:
-    AddrSpace(OpenFile *executable);	// Create an address space,
+    AddrSpace(OpenFile *executable, char *name);
+					// Create an address space,
 					// initializing it with the program
-					// stored in the file "executable"
+					// stored in the file "executable",
+					// called "name"
+    AddrSpace(AddrSpace *parent);	// Create a copy of "parent", for
+					// Fork, sharing its pages until
+					// either one writes to them
     ~AddrSpace();			// De-allocate an address space
 
     void InitRegisters();		// Initialize user-level CPU registers,
@@ -32,63 +54,113 @@ class AddrSpace {
 
     void SaveState();			// Save/restore address space-specific
     void RestoreState();		// info on a context switch 
+
+    TranslationEntry *getPageTableEntry(int virtualPage)
+	{ return &pageTable[virtualPage]; }
+    static void SaveTLBEntry(int entry);// move a TLB entry's use and dirty
+					// bits back into its page table
+    void FlushTLB();			// do so for all of our TLB entries
+    void FlushTLBPage(int virtualPage);	// or for "virtualPage"'s, if any
+
+    int VirtualTime();			// user instructions we have executed
+    int PageAge(int virtualPage);	// virtual time since the page was used
+    int WorkingSetSize();		// pages used in the last WSWindow
+    void ControlLoad();			// at a page fault, suspend us if
+					// memory is overcommitted
+    static bool ResumeProcess(bool force);
+					// resume a suspended process, if
+					// it fits
+    bool suspended;			// stopped by the load controller
+
+    void ClearUse(int virtualPage);	// clear a page's use bit
+
+    static void ReplacementOrder(int *frames);
+					// the frames, in the order page
+					// replacement will look at them
+    void StartClean(int virtualPage, int physPage);
+					// write a dirty page to swap, and
+					// leave it mapped
+    void MergePage(int virtualPage, int frame);
+					// share "frame", which has the same
+					// data as the page
+    bool CopyOnWrite(int badVAddr);	// on a write to a shared page: give
+					// it its own frame again
+    static void SwapoutShared(int frame);
+					// evict all the pages in a shared
+					// frame
+    void setReadOnly(int vpage, bool set);
+
+    Profile *profile;			// where the program spends its
+					// time, if it is being profiled
     
     // Begin code changes by Chet Ransonet
     void loadPage(int badVAddrReg);
+    void PageIn(int virtualPage, int physPage);
+					// fill a frame with one of our pages
+    int ReadSegment(Segment *segment, int virtualPage, int physPage);
+					// the part of "segment" on the page
     int getNumPages()
     	{return numPages;};
-    bool * swapped;
     // End code changes by Chet Ransonet
     
     //Begin code changes by Ryan Mazerole
-    void Swap(int pageNum);
-    void DestroySwapFile();
-
 	bool Swapin(int page, int frame);
 	
    	bool Swapout(int frame);
+   	bool ClusterCandidate(int virtualPage);
+					// can go out with a dirty neighbour
+   	void Unload(int virtualPage);	// take a page out of its frame
    	
-   	void savePageTableEntry(TranslationEntry entry, int virtualPage){
-   		pageTable[virtualPage] = entry;
-   	};
-   	
-   	TranslationEntry pageTableEntry(int physPage)
-   	{
-   		for(unsigned int i=0; i < numPages; i++)
-   		{
-   			if(pageTable[i].physicalPage == physPage)
-   				return pageTable[i];
-   		}
-   		ASSERT(false); // we should not be reaching this assert
-   	};
+   	void savePageTableEntry(TranslationEntry entry, int virtualPage);
    	
-   	int getPageNumber(int frame){
-		//printf("Running get page number in addrspace.h \nFrame = %d\n numPages = %d\n ", frame);
-   		for(unsigned int i = 0; i < numPages; i++){
-   				if(pageTable[i].physicalPage == frame && pageTable[i].valid == true){
-   					return i;
-   				}
-   				else
-   					return -1;
-   		}
-   		return -1;
-   	};
+   	void setDirty(int vpage, bool set);
    	
-   	void setDirty(int vpage, bool set){
-   		pageTable[vpage].dirty = set;
-   	};
-   	
-   	void setValidity(int vpage, bool set){
-   		pageTable[vpage].valid = set;
-   	};
+   	void setValidity(int vpage, bool set);
    	//End code changes by Ryan Mazerole
 
   private:
+    int asid;				// tags our TLB entries
+    unsigned int asidGeneration;	// "asid" is only ours if this is
+					// the current ASID generation
+    void AssignASID();			// get an ASID nobody else has
+
+    int virtualTime;			// user instructions, up to "runStart"
+    int runStart;			// userTicks when we last started running
+    bool running;			// "runStart" is valid
+    int *lastUse;			// the virtual time each page was last
+					// seen to be used
+    int lastFault;			// virtual time of our last page fault
+    int suspendedSize;			// our working set when suspended
+    int wsSamples, wsTotal, wsPeak;	// working set sizes at our faults
+    int suspensions;			// times we were suspended
+    AddrSpace *nextSpace;		// next address space on "allSpaces"
+    static int ActiveDemand();		// pages needed by the working sets of
+					// the processes not suspended
+
+    bool *prefetched;			// brought in by Prefetch, and not yet
+					// found used or unused
+    int prefetchWindow;			// pages to bring in at the next fault
+    int nextSequential[PrefetchStreams];// the pages whose faults would mean
+					// we are being read sequentially
+    int nextStream;			// the entry to reuse for a new one
+    void Prefetch(int virtualPage);	// bring in the pages after a fault
+    int SegmentEnd(int virtualPage);	// the last page of its segment
+    void RetirePrefetch(int virtualPage);
+					// count a prefetch as a hit or wasted
+
   	// Begin code changes by Chet Ransonet
     OpenFile * file;
-    OpenFile * swapFile;
     NoffHeader noffH;
     // End code changes by Chet Ransonet
+    int *fileUsers;			// address spaces sharing "file": a
+					// process, and its copies by Fork
+    char *program;			// the program, for the page cache
+    bool CodePage(int virtualPage);	// the page holds nothing but code
+    bool MapCached(int virtualPage);	// map the page to the page cache's
+					// frame for it, if there is one
+    int ReadPage(int virtualPage, int physPage);
+					// the whole page, from an executable
+					// laid out by coff2noff -a
   
     TranslationEntry *pageTable;	// Assume linear page table translation
 					// for now!
@@ -97,10 +169,11 @@ class AddrSpace {
 	unsigned int startPage;		//Page number that the program starts at
 								//in physical memory
 	bool space;		//Boolean to remember if there was enough space or not
-	
-	//Begin code changes by Ryan Mazerole
-    char swapfilename[8];
-    //end code changes by Ryan Mazerole
+
+    int *swapSlot;			// the swap slot holding each page, or
+					// -1 if it has never been written out
+    int SwapSlot(int virtualPage);	// the page's slot, allocating it
+					// if need be
 };
 
 #endif // ADDRSPACE_H
@@ -39,6 +39,12 @@ Thread * getID(int toGet);
 
 // end FA98
 
+static void TLBMissHandler(int badVAddr);
+static void HandlePageFault(int badVAddr);
+static bool CopyFromUser(int virtAddr, char *buffer, int size);
+static bool CopyToUser(int virtAddr, char *buffer, int size);
+static int CopyStringFromUser(int virtAddr, char *buffer, int size);
+
 //----------------------------------------------------------------------
 // ExceptionHandler
 // 	Entry point into the Nachos kernel.  Called when a user program
@@ -102,6 +108,262 @@ void processCreator(int arg)	// Used when a process first actually runs, not whe
     ASSERT(FALSE);			// machine->Run never returns;
  }
 
+//----------------------------------------------------------------------
+// forkCreator
+// 	The first thing a process made by Fork does: start running user
+//	code, with the registers it was given.
+//
+//	"arg" -- the registers, NumTotalRegs of them, which are deleted
+//----------------------------------------------------------------------
+
+static void
+forkCreator(int arg)
+{
+	int *registers = (int *) arg;
+
+	for (int i = 0; i < NumTotalRegs; i++)
+		machine->WriteRegister(i, registers[i]);
+	delete [] registers;
+	currentThread->space->RestoreState();
+
+	if (threadToBeDestroyed != NULL){
+		delete threadToBeDestroyed;
+		threadToBeDestroyed = NULL;
+	}
+
+	machine->Run();
+	ASSERT(FALSE);
+}
+
+//----------------------------------------------------------------------
+// ChooseTLBEntry
+// 	Pick the entry of the TLB that a translation for "vpn" will
+//	be loaded into: a free entry of the set the page maps to, or
+//	else the one tlbChoice says to replace.
+//----------------------------------------------------------------------
+
+static unsigned int *tlbLoaded = NULL;	// when each TLB entry was loaded,
+					// for FIFO replacement
+static unsigned int tlbLoads = 0;	// number of TLB entries loaded
+
+static int
+ChooseTLBEntry(unsigned int vpn)
+{
+	int first = machine->TLBSet(vpn, machine->asid);
+	int victim = first;
+
+	for (int i = first; i < first + machine->tlbWays; i++)
+		if (!machine->tlb[i].valid)
+			return i;
+	switch (tlbChoice) {
+	case TLBFIFO :
+		for (int i = first + 1; i < first + machine->tlbWays; i++)
+			if (tlbLoaded[i] < tlbLoaded[victim])
+				victim = i;
+		break;
+	case TLBLRU :
+		for (int i = first + 1; i < first + machine->tlbWays; i++)
+			if (machine->tlbUsed[i] < machine->tlbUsed[victim])
+				victim = i;
+		break;
+	default :
+		victim = first + Random() % machine->tlbWays;
+		break;
+	}
+	return victim;
+}
+
+//----------------------------------------------------------------------
+// TLBMissHandler
+// 	Called on a PageFaultException when the machine has a TLB.  The
+//	page's translation was not in the TLB; load it from the running
+//	address space's page table, bringing the page into memory first
+//	if that is where the fault really is.
+//
+//	The new entry is tagged with the running address space's ASID.
+//	The TLB is updated with interrupts off; turning them back on
+//	charges the kernel's time, which is also counted as the cost
+//	of the refill.  Bringing the page in is not: the thread may
+//	have to wait for that, while others run.
+//
+//	"badVAddr" -- the virtual address that missed
+//----------------------------------------------------------------------
+
+static void
+TLBMissHandler(int badVAddr)
+{
+	AddrSpace *space = currentThread->space;
+	unsigned int vpn = (unsigned) badVAddr / PageSize;
+	int start;
+	TranslationEntry *entry;
+	IntStatus oldLevel;
+	int victim;
+
+	if (vpn >= (unsigned) space->getNumPages()) {
+		ExceptionHandler(AddressErrorException);
+		return;
+	}
+	if (!space->getPageTableEntry(vpn)->valid)
+		space->loadPage(badVAddr);
+	entry = space->getPageTableEntry(vpn);
+	start = stats->totalTicks;
+
+	oldLevel = interrupt->SetLevel(IntOff);
+	if (tlbLoaded == NULL) {
+		tlbLoaded = new unsigned int[machine->tlbSize];
+		for (int i = 0; i < machine->tlbSize; i++)
+			tlbLoaded[i] = 0;
+	}
+	victim = ChooseTLBEntry(vpn);
+	if (machine->tlb[victim].valid)
+		AddrSpace::SaveTLBEntry(victim);
+	machine->tlb[victim] = *entry;
+	machine->tlb[victim].use = FALSE;
+	machine->tlb[victim].dirty = FALSE;
+	machine->tlb[victim].asid = machine->asid;
+	tlbLoaded[victim] = ++tlbLoads;
+	machine->tlbUsed[victim] = machine->tlbClock;
+	stats->numTLBRefillTicks += stats->totalTicks - start + SystemTick;
+	(void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// HandlePageFault
+// 	Make the page holding "badVAddr" accessible to the running
+//	program: load its translation into the TLB, if there is one, or
+//	else bring the page into memory.
+//----------------------------------------------------------------------
+
+static void
+HandlePageFault(int badVAddr)
+{
+	if (machine->tlb != NULL)
+		TLBMissHandler(badVAddr);
+	else
+		currentThread->space->loadPage(badVAddr);
+}
+
+//----------------------------------------------------------------------
+// UserAddress
+// 	Find where a byte of the running program's memory is in
+//	mainMemory, faulting its page in first if need be, so that the
+//	kernel can copy to or from the rest of the page directly.  The
+//	page's use bit, and its dirty bit if "writing", get set as if
+//	the program had touched it.
+//
+//	Returns NULL if "virtAddr" is not in the address space, or if
+//	"writing" and the page is read-only (other than because it is
+//	shared, which is undone).
+//----------------------------------------------------------------------
+
+static char *
+UserAddress(int virtAddr, bool writing)
+{
+	ExceptionType exception;
+	int physAddr;
+
+	if (virtAddr < 0 || (unsigned) virtAddr / PageSize
+			>= (unsigned) currentThread->space->getNumPages())
+		return NULL;
+	for (;;) {
+		exception = machine->Translate(virtAddr, &physAddr, 1, writing);
+		if (exception == PageFaultException)
+			HandlePageFault(virtAddr);
+		else if (exception != ReadOnlyException
+			 || !currentThread->space->CopyOnWrite(virtAddr))
+			break;
+	}
+	if (exception != NoException)
+		return NULL;
+	return &machine->mainMemory[physAddr];
+}
+
+//----------------------------------------------------------------------
+// CopyFromUser, CopyToUser
+// 	Copy "size" bytes between the running program's memory at
+//	"virtAddr" and the kernel's "buffer", translating each page
+//	once and copying all of it that is wanted at a time.
+//
+//	Returns FALSE if some of the user's bytes are not in its
+//	address space (or are read-only, for CopyToUser); some bytes
+//	may have been copied.
+//----------------------------------------------------------------------
+
+static bool
+CopyFromUser(int virtAddr, char *buffer, int size)
+{
+	char *from;
+	int n;
+
+	while (size > 0) {
+		if ((from = UserAddress(virtAddr, FALSE)) == NULL)
+			return FALSE;
+		n = PageSize - virtAddr % PageSize;
+		if (n > size)
+			n = size;
+		memcpy(buffer, from, n);
+		virtAddr += n;
+		buffer += n;
+		size -= n;
+	}
+	return TRUE;
+}
+
+static bool
+CopyToUser(int virtAddr, char *buffer, int size)
+{
+	char *to;
+	int n;
+
+	while (size > 0) {
+		if ((to = UserAddress(virtAddr, TRUE)) == NULL)
+			return FALSE;
+		n = PageSize - virtAddr % PageSize;
+		if (n > size)
+			n = size;
+		memcpy(to, buffer, n);
+		machine->InvalidateCode(to - machine->mainMemory, n);
+		virtAddr += n;
+		buffer += n;
+		size -= n;
+	}
+	return TRUE;
+}
+
+//----------------------------------------------------------------------
+// CopyStringFromUser
+// 	Copy a null-terminated string from the running program's memory
+//	at "virtAddr" into the kernel's "buffer", which holds "size"
+//	bytes, a page at a time.
+//
+//	Returns the length of the string, or -1 if it runs out of the
+//	address space or does not fit in "buffer".
+//----------------------------------------------------------------------
+
+static int
+CopyStringFromUser(int virtAddr, char *buffer, int size)
+{
+	char *from, *end;
+	int length = 0, n;
+
+	while (length < size) {
+		if ((from = UserAddress(virtAddr, FALSE)) == NULL)
+			return -1;
+		n = PageSize - virtAddr % PageSize;
+		if (n > size - length)
+			n = size - length;
+		end = (char *) memchr(from, '\0', n);
+		if (end != NULL)
+			n = end - from + 1;
+		memcpy(buffer + length, from, n);
+		length += n;
+		virtAddr += n;
+		if (end != NULL)
+			return length - 1;
+	}
+	return -1;
+}
+
 void
 ExceptionHandler(ExceptionType which)
 {
@@ -111,8 +373,6 @@ ExceptionHandler(ExceptionType which)
 	int arg2 = machine->ReadRegister(5);
 	int arg3 = machine->ReadRegister(6);
 	int Result;
-	int i, j;
-	char *ch = new char [500];
 
 	// Begin code changes by Chet Ransonet
 	int invalidPageAddr;
@@ -151,23 +411,22 @@ ExceptionHandler(ExceptionType which)
 			break;
 
 		case SC_Write :
-			for (j = 0; ; j++) {
-				if(!machine->ReadMem((arg1+j), 1, &i))
-					j=j-1;
-				else{
-					ch[j] = (char) i;
-					if (ch[j] == '\0') 
-						break;
-				}
-			}
-			if (j == 0){
+		   {
+			if (arg2 <= 0) {
 				printf("\nWrite 0 byte.\n");
 				// SExit(1);
-			} else {
-				DEBUG('t', "\nWrite %d bytes from %s to the open file(OpenFileId is %d).", arg2, ch, arg3);
-				SWrite(ch, j, arg3);
+				break;
+			}
+			char *buffer = new char[arg2 + 1];
+
+			if (CopyFromUser(arg1, buffer, arg2)) {
+				buffer[arg2] = '\0';
+				DEBUG('t', "\nWrite %d bytes from %s to the open file(OpenFileId is %d).", arg2, buffer, arg3);
+				SWrite(buffer, arg2, arg3);
 			}
+			delete [] buffer;
 			break;
+		   }
 		case SC_Exec :	// Executes a user process inside another user process.
 		   {
 				printf("SYSTEM CALL: Exec, called by thread %i.\n",currentThread->getID());
@@ -177,24 +436,15 @@ ExceptionHandler(ExceptionType which)
 
 				// Read file name into the kernel space
 				char *filename = new char[100];
-				
-				for(int m = 0; m < 100; m++)
-					filename[m] = NULL;
 					
 				printf("fileAddress = %i\n", fileAddress); //debug
 			
-				// Free up allocation space and get the file name
-				if(!machine->ReadMem(fileAddress,1,&j))
-					machine->ReadMem(fileAddress,1,&j); //return;
-				
-				i = 0;
-				
-				while(j != 0)
+				if (CopyStringFromUser(fileAddress, filename, 100) < 0)
 				{
-					filename[i]=(char)j;
-					fileAddress += 1;
-					i++;
-					if(!machine->ReadMem(fileAddress,1,&j))return;
+					printf("Unable to read file name at %i\n", fileAddress);
+					machine->WriteRegister(2, -1);
+					delete [] filename;
+					break;
 				}
 				
 				printf("Attempting to open file %s\n", filename);
@@ -205,14 +455,17 @@ ExceptionHandler(ExceptionType which)
 				if (executable == NULL) 
 				{
 					printf("Unable to open file %s\n", filename);
-					delete filename;
+					delete [] filename;
 					break;
 				}
-				delete filename;
 
 				// Calculate needed memory space
 				AddrSpace *space;
-				space = new AddrSpace(executable);
+				space = new AddrSpace(executable, filename);
+				if (profiler != NULL)
+					space->profile = profiler->NewProfile(filename,
+						space->getNumPages() * PageSize);
+				delete [] filename;
 				//delete executable;
 				
 				// Do we have enough space?
@@ -271,10 +524,35 @@ ExceptionHandler(ExceptionType which)
 				
 				if(currentThread->space)	// Delete the used memory from the process.
 					delete currentThread->space;
+				currentThread->space = NULL;
 				currentThread->Finish();	// Delete the thread.
 
 				break;
 			}
+		case SC_Fork :	// Start a copy of this process.
+		   {
+			printf("SYSTEM CALL: Fork, called by thread %i.\n",currentThread->getID());
+
+			// The child gets our registers, but returns 0 from
+			// Fork, or starts at "func" if there is one.
+			Thread *forkThread = new Thread("forked");
+			int *registers = new int[NumTotalRegs];
+
+			forkThread->space = new AddrSpace(currentThread->space);
+			for (int i = 0; i < NumTotalRegs; i++)
+				registers[i] = machine->ReadRegister(i);
+			registers[2] = 0;
+			if (arg1 != 0) {
+				registers[PCReg] = arg1;
+				registers[NextPCReg] = arg1 + 4;
+			}
+			forkThread->setID(threadID);
+			activeThreads->Append(forkThread);
+			machine->WriteRegister(2, threadID);
+			threadID++;
+			forkThread->Fork(forkCreator, (int) registers);
+			break;
+		   }
            case SC_Yield :	// Yield to a new process.
 		   {
 			   printf("SYSTEM CALL: Yield, called by thread %i.\n",currentThread->getID());
@@ -295,11 +573,16 @@ ExceptionHandler(ExceptionType which)
            break;
 
 	case ReadOnlyException :
+		// A shared page is read-only until it is written to.
+		if (currentThread->space != NULL && currentThread->space->
+		    CopyOnWrite(machine->ReadRegister(BadVAddrReg)))
+			return;		// and the write is tried again
 		printf("ERROR: ReadOnlyException, called by thread %i.\n",currentThread->getID());
 		if (currentThread->getName() == "main")
 			ASSERT(FALSE);  //Not the way of handling an exception.
 		if(currentThread->space)	// Delete the used memory from the process.
 			delete currentThread->space;
+		currentThread->space = NULL;
 		currentThread->Finish();	// Delete the thread.
 		break;
 	case BusErrorException :
@@ -308,6 +591,7 @@ ExceptionHandler(ExceptionType which)
 			ASSERT(FALSE);  //Not the way of handling an exception.
 		if(currentThread->space)	// Delete the used memory from the process.
 			delete currentThread->space;
+		currentThread->space = NULL;
 		currentThread->Finish();	// Delete the thread.
 		break;
 	case AddressErrorException :
@@ -316,6 +600,7 @@ ExceptionHandler(ExceptionType which)
 			ASSERT(FALSE);  //Not the way of handling an exception.
 		if(currentThread->space)	// Delete the used memory from the process.
 			delete currentThread->space;
+		currentThread->space = NULL;
 		currentThread->Finish();	// Delete the thread.
 		break;
 	case OverflowException :
@@ -324,6 +609,7 @@ ExceptionHandler(ExceptionType which)
 			ASSERT(FALSE);  //Not the way of handling an exception.
 		if(currentThread->space)	// Delete the used memory from the process.
 			delete currentThread->space;
+		currentThread->space = NULL;
 		currentThread->Finish();	// Delete the thread.
 		break;
 	case IllegalInstrException :
@@ -332,6 +618,7 @@ ExceptionHandler(ExceptionType which)
 			ASSERT(FALSE);  //Not the way of handling an exception.
 		if(currentThread->space)	// Delete the used memory from the process.
 			delete currentThread->space;
+		currentThread->space = NULL;
 		currentThread->Finish();	// Delete the thread.
 		break;
 	case NumExceptionTypes :
@@ -340,6 +627,7 @@ ExceptionHandler(ExceptionType which)
 			ASSERT(FALSE);  //Not the way of handling an exception.
 		if(currentThread->space)	// Delete the used memory from the process.
 			delete currentThread->space;
+		currentThread->space = NULL;
 		currentThread->Finish();	// Delete the thread.
 		break;
 		
@@ -349,7 +637,7 @@ ExceptionHandler(ExceptionType which)
 		
 		//printf("\nPageFaultException!\n");//invalidPageAddr = %i\n", invalidPageAddr);
 		
-		currentThread->space->loadPage(invalidPageAddr);
+		HandlePageFault(invalidPageAddr);
 		
 		return;
 		
@@ -362,7 +650,6 @@ ExceptionHandler(ExceptionType which)
 		//      SExit(1);
 		break;
 	}
-	delete [] ch;
 }
 
 
@@ -387,10 +674,12 @@ static int SRead(int addr, int size, int id)  //input 0  output 1
 			Result = num + 1;
 		}
 
+		// copy up to and including the null, if it is in the
+		// first Result bytes
 		for (num=0; num<Result; num++)
-		{  machine->WriteMem((addr+num), 1, (int) buffer[num]);
 			if (buffer[num] == '\0')
-			break; }
+				break;
+		CopyToUser(addr, buffer, (num < Result) ? num + 1 : num);
 		return num;
 
 	}
@@ -399,9 +688,9 @@ static int SRead(int addr, int size, int id)  //input 0  output 1
 	{
 		for(num=0;num<size;num++){
 			Read(id,&buffer[num],1);
-			machine->WriteMem((addr+num), 1, (int) buffer[num]);
 			if(buffer[num]=='\0') break;
 		}
+		CopyToUser(addr, buffer, (num < size) ? num + 1 : num);
 		return num;
 	}
 }
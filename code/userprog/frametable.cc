@@ -0,0 +1,474 @@
+// frametable.cc
+//	Routines to keep track of what is in each physical frame.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "frametable.h"
+#include "addrspace.h"
+
+//----------------------------------------------------------------------
+// FrameQueue::FrameQueue
+// 	Initialize an empty queue of frames.
+//----------------------------------------------------------------------
+
+FrameQueue::FrameQueue()
+{
+    first = last = NULL;
+}
+
+//----------------------------------------------------------------------
+// FrameQueue::Append
+// 	Put a frame at the end of the queue.
+//
+//	"entry" -- the frame, which must not be on any queue
+//----------------------------------------------------------------------
+
+void
+FrameQueue::Append(FrameEntry *entry)
+{
+    ASSERT(!entry->queued);
+    entry->next = NULL;
+    entry->prev = last;
+    if (last == NULL)
+	first = entry;
+    else
+	last->next = entry;
+    last = entry;
+    entry->queued = TRUE;
+}
+
+//----------------------------------------------------------------------
+// FrameQueue::Remove
+// 	Take a frame off the queue, wherever it is on it.
+//
+//	"entry" -- the frame, which must be on this queue
+//----------------------------------------------------------------------
+
+void
+FrameQueue::Remove(FrameEntry *entry)
+{
+    ASSERT(entry->queued);
+    if (entry->prev == NULL)
+	first = entry->next;
+    else
+	entry->prev->next = entry->next;
+    if (entry->next == NULL)
+	last = entry->prev;
+    else
+	entry->next->prev = entry->prev;
+    entry->next = entry->prev = NULL;
+    entry->queued = FALSE;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::FrameTable
+// 	Initialize the frame table, with every frame empty.
+//
+//	"nframes" -- how many frames of physical memory there are
+//----------------------------------------------------------------------
+
+FrameTable::FrameTable(int nframes)
+{
+    numFrames = nframes;
+    frames = new FrameEntry[numFrames];
+    for (int i = 0; i < numFrames; i++) {
+	frames[i].space = NULL;
+	frames[i].virtualPage = -1;
+	frames[i].pinned = 0;
+	frames[i].next = frames[i].prev = NULL;
+	frames[i].queued = FALSE;
+	frames[i].inTransit = FALSE;
+	frames[i].waiters = new List;
+	frames[i].zeroed = TRUE;	// the machine starts out that way
+	frames[i].sharers = NULL;
+	frames[i].hashed = FALSE;
+    }
+    numPinned = 0;
+    unpinWaiters = new List;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::~FrameTable
+// 	De-allocate the frame table.
+//----------------------------------------------------------------------
+
+FrameTable::~FrameTable()
+{
+    for (int i = 0; i < numFrames; i++)
+	delete frames[i].waiters;
+    delete unpinWaiters;
+    delete [] frames;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Map
+// 	Record that a page has been given a frame.  The frame goes to
+//	the end of the "loaded" queue.
+//
+//	"frame" -- the frame
+//	"space", "virtualPage" -- the page now in it
+//----------------------------------------------------------------------
+
+void
+FrameTable::Map(int frame, AddrSpace *space, int virtualPage)
+{
+    FrameEntry *entry = &frames[frame];
+
+    ASSERT(frame >= 0 && frame < numFrames);
+    if (entry->queued)
+	loaded.Remove(entry);
+    entry->space = space;
+    entry->virtualPage = virtualPage;
+    entry->hashed = FALSE;
+    loaded.Append(entry);
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Unmap
+// 	Record that a frame no longer holds any page.
+//
+//	"frame" -- the frame
+//----------------------------------------------------------------------
+
+void
+FrameTable::Unmap(int frame)
+{
+    FrameEntry *entry = &frames[frame];
+
+    ASSERT(frame >= 0 && frame < numFrames && entry->sharers == NULL);
+    if (entry->queued)
+	loaded.Remove(entry);
+    entry->space = NULL;
+    entry->virtualPage = -1;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Pin
+// 	Keep a frame from being evicted, until it is unpinned.
+//
+//	"frame" -- the frame
+//----------------------------------------------------------------------
+
+void
+FrameTable::Pin(int frame)
+{
+    if (frames[frame].pinned++ == 0)
+	numPinned++;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Unpin
+// 	Let a frame be evicted again, once everyone who pinned it has
+//	unpinned it.  Anyone waiting for a frame that can be evicted is
+//	woken up.  Called by the swap device's interrupt handler, too.
+//
+//	"frame" -- the frame
+//----------------------------------------------------------------------
+
+void
+FrameTable::Unpin(int frame)
+{
+    Thread *thread;
+    IntStatus oldLevel;
+
+    ASSERT(frames[frame].pinned > 0);
+    if (--frames[frame].pinned > 0)
+	return;
+    numPinned--;
+    if (unpinWaiters->IsEmpty())
+	return;				// (and don't touch the interrupt
+					// level, which would take a tick)
+    oldLevel = interrupt->SetLevel(IntOff);
+    while ((thread = (Thread *) unpinWaiters->Remove()) != NULL)
+	scheduler->ReadyToRun(thread);
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// FrameTable::WaitForUnpin
+// 	Every frame is pinned, so there is nothing to evict.  Sleep until
+//	one is unpinned; the caller then looks again.
+//----------------------------------------------------------------------
+
+void
+FrameTable::WaitForUnpin()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    if (AllPinned()) {
+	unpinWaiters->Append((void *) currentThread);
+	currentThread->Sleep();
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// FrameTable::StartTransfer
+// 	Record that a page is being read into a frame, or written out
+//	of it.  The frame must be pinned until the transfer is done.
+//
+//	"frame" -- the frame
+//----------------------------------------------------------------------
+
+void
+FrameTable::StartTransfer(int frame)
+{
+    ASSERT(IsPinned(frame) && !frames[frame].inTransit);
+    frames[frame].inTransit = TRUE;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::FinishTransfer
+// 	Record that a frame's transfer is done, and wake up every thread
+//	waiting for it.  Called by the swap device's interrupt handler.
+//
+//	"frame" -- the frame
+//----------------------------------------------------------------------
+
+void
+FrameTable::FinishTransfer(int frame)
+{
+    Thread *thread;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    ASSERT(frames[frame].inTransit);
+    frames[frame].inTransit = FALSE;
+    while ((thread = (Thread *) frames[frame].waiters->Remove()) != NULL)
+	scheduler->ReadyToRun(thread);
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// FrameTable::WaitForTransfer
+// 	Sleep until a frame's transfer is done.  Returns at once if the
+//	frame is not in transit.
+//
+//	"frame" -- the frame
+//----------------------------------------------------------------------
+
+void
+FrameTable::WaitForTransfer(int frame)
+{
+    IntStatus oldLevel;
+
+    if (!frames[frame].inTransit)
+	return;
+    oldLevel = interrupt->SetLevel(IntOff);
+    while (frames[frame].inTransit) {
+	frames[frame].waiters->Append((void *) currentThread);
+	currentThread->Sleep();
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// FrameTable::FindFree
+// 	Allocate a free frame (mark it in use in memMap).  A page that
+//	starts out zeroed wants a frame that is already zeroed; any other
+//	page is going to be overwritten anyway, and takes one that is not,
+//	to leave the zeroed frames for those that can use them.  Either
+//	way, any free frame will do if there is none of the kind wanted.
+//
+//	"wantZeroed" -- whether a zeroed frame is wanted
+//
+// Returns:
+//	The frame, or -1 if none is free.
+//----------------------------------------------------------------------
+
+int
+FrameTable::FindFree(bool wantZeroed)
+{
+    for (int frame = 0; frame < numFrames; frame++)
+	if (!memMap->Test(frame) && frames[frame].zeroed == wantZeroed) {
+	    memMap->Mark(frame);
+	    return frame;
+	}
+    return memMap->Find();
+}
+
+//----------------------------------------------------------------------
+// FrameTable::UseZeroed
+// 	A page is about to be put in a frame.  Say whether the frame is
+//	zeroed (so the page need not clear it), and record that it will
+//	not be any more.
+//
+//	"frame" -- the frame
+//----------------------------------------------------------------------
+
+bool
+FrameTable::UseZeroed(int frame)
+{
+    bool zeroed = frames[frame].zeroed;
+
+    frames[frame].zeroed = FALSE;
+    return zeroed;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::ZeroFreeFrames
+// 	Called when there is nothing to run: zero the free frames that
+//	are not zeroed yet, so that pages that start out zeroed will
+//	not have to.  This costs nothing, since the CPU is idle anyway.
+//----------------------------------------------------------------------
+
+void
+FrameTable::ZeroFreeFrames()
+{
+    for (int frame = 0; frame < numFrames; frame++)
+	if (!memMap->Test(frame) && !frames[frame].zeroed) {
+	    bzero(machine->mainMemory + frame * PageSize, PageSize);
+	    frames[frame].zeroed = TRUE;
+	    stats->numFramesZeroedIdle++;
+	}
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Share
+// 	Record that a frame holds another page as well, with the same
+//	data as the one it already has: merged with it, or the page of
+//	a copy of its address space made by Fork.
+//
+//	"frame" -- the frame, which must be mapped
+//	"space", "virtualPage" -- the other page
+//----------------------------------------------------------------------
+
+void
+FrameTable::Share(int frame, AddrSpace *space, int virtualPage)
+{
+    FrameEntry *entry = &frames[frame];
+    FrameSharer *sharer = new FrameSharer;
+
+    ASSERT(entry->space != NULL);
+    sharer->space = space;
+    sharer->virtualPage = virtualPage;
+    sharer->next = entry->sharers;
+    entry->sharers = sharer;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::Unshare
+// 	Take one of the pages in a shared frame out of it.  If it is the
+//	page the frame's entry records, one of the others takes its
+//	place.
+//
+//	"frame" -- the frame
+//	"space", "virtualPage" -- the page
+//
+// Returns:
+//	FALSE, doing nothing, if the frame is not shared: the page is
+//	the only one in it.
+//----------------------------------------------------------------------
+
+bool
+FrameTable::Unshare(int frame, AddrSpace *space, int virtualPage)
+{
+    FrameEntry *entry = &frames[frame];
+    FrameSharer **prev, *sharer;
+
+    if (entry->sharers == NULL)
+	return FALSE;
+    if (entry->space == space && entry->virtualPage == virtualPage) {
+	sharer = entry->sharers;	// it takes the page's place
+	entry->space = sharer->space;
+	entry->virtualPage = sharer->virtualPage;
+	entry->sharers = sharer->next;
+    } else {
+	for (prev = &entry->sharers; (*prev)->space != space
+		 || (*prev)->virtualPage != virtualPage; prev = &(*prev)->next)
+	    ASSERT((*prev)->next != NULL);
+	sharer = *prev;
+	*prev = sharer->next;
+    }
+    delete sharer;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::PageTableEntry
+// 	Return the page table entry that maps a frame.  With a TLB, the
+//	hardware sets the use and dirty bits in the page's TLB entry,
+//	so it is written back (and dropped) first.  For a shared frame,
+//	this is only the entry of the page the frame's entry records;
+//	IsUsed, IsDirty and ClearUse look at all of its pages.
+//
+//	"frame" -- the frame, which must hold a page
+//----------------------------------------------------------------------
+
+TranslationEntry *
+FrameTable::PageTableEntry(int frame)
+{
+    FrameEntry *entry = &frames[frame];
+
+    ASSERT(entry->space != NULL);
+    entry->space->FlushTLBPage(entry->virtualPage);
+    return entry->space->getPageTableEntry(entry->virtualPage);
+}
+
+//----------------------------------------------------------------------
+// FrameTable::SharerEntry
+// 	Return the page table entry of one of the other pages sharing a
+//	frame, with its use and dirty bits written back from the TLB.
+//
+//	"sharer" -- the page
+//----------------------------------------------------------------------
+
+TranslationEntry *
+FrameTable::SharerEntry(FrameSharer *sharer)
+{
+    sharer->space->FlushTLBPage(sharer->virtualPage);
+    return sharer->space->getPageTableEntry(sharer->virtualPage);
+}
+
+//----------------------------------------------------------------------
+// FrameTable::IsUsed, IsDirty
+// 	Say whether any page in a frame has been used since its use bit
+//	was last cleared, or is dirty.  A shared frame is used if any of
+//	the address spaces sharing it uses it.
+//
+//	"frame" -- the frame, which must hold a page
+//----------------------------------------------------------------------
+
+bool
+FrameTable::IsUsed(int frame)
+{
+    bool used = PageTableEntry(frame)->use;
+
+    for (FrameSharer *sharer = frames[frame].sharers; sharer != NULL;
+	 sharer = sharer->next)
+	used = used || SharerEntry(sharer)->use;
+    return used;
+}
+
+bool
+FrameTable::IsDirty(int frame)
+{
+    bool dirty = PageTableEntry(frame)->dirty;
+
+    for (FrameSharer *sharer = frames[frame].sharers; sharer != NULL;
+	 sharer = sharer->next)
+	dirty = dirty || SharerEntry(sharer)->dirty;
+    return dirty;
+}
+
+//----------------------------------------------------------------------
+// FrameTable::ClearUse
+// 	Clear the use bit of every page in a frame, to see whether the
+//	frame is used again.
+//
+//	"frame" -- the frame, which must hold a page
+//----------------------------------------------------------------------
+
+void
+FrameTable::ClearUse(int frame)
+{
+    FrameEntry *entry = &frames[frame];
+
+    entry->space->ClearUse(entry->virtualPage);
+    for (FrameSharer *sharer = entry->sharers; sharer != NULL;
+	 sharer = sharer->next)
+	sharer->space->ClearUse(sharer->virtualPage);
+}
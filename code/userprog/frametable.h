@@ -0,0 +1,156 @@
+// frametable.h
+//	Data structures to keep track of physical memory: for each
+//	frame, which page of which address space is in it.
+//
+//	The frame table is the inverse of the page tables (an "inverted
+//	page table").  Page replacement works on frames; the frame table
+//	says, without searching any page table, whose page has to be
+//	evicted to free one.
+//
+//	A frame's referenced and dirty state is the use and dirty bits
+//	of the page table entry that maps it, since that is where the
+//	hardware sets them; FrameTable::PageTableEntry finds the entry.
+//	A shared frame is referenced or dirty if any of its pages is.
+//
+//	A frame that is pinned is never chosen for eviction: its page is
+//	being brought in or written out, and the thread doing so may be
+//	switched out before it is done.
+//
+//	A page read from swap arrives some time after the read is
+//	started.  Until then the frame is "in transit", and a thread
+//	that faults on the page waits on the frame's queue of waiters,
+//	rather than bringing the page in again.  A frame whose page is
+//	being written to swap while it stays mapped (by the page
+//	cleaner) is in transit too.
+//
+//	A frame may hold a page of several address spaces at once, merged
+//	by the page merger (see pagemerger.h), or shared by a process and
+//	its copy made by Fork.  The frame's entry records one of them, as
+//	usual, and a list of the others.  A shared frame can be evicted
+//	like any other; all of its pages go at once (see
+//	AddrSpace::SwapoutShared).
+//
+//	Free frames that are known to be all zeros are kept track of, so
+//	that a page that starts out zeroed can be given one without
+//	clearing it on the fault path.  Memory starts out zeroed, and
+//	free frames are zeroed again when the CPU would otherwise be
+//	idle.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FRAMETABLE_H
+#define FRAMETABLE_H
+
+#include "copyright.h"
+#include "utility.h"
+#include "translate.h"
+#include "list.h"
+
+class AddrSpace;
+
+// Another page in a frame, besides the one its FrameEntry records.
+
+class FrameSharer {
+  public:
+    AddrSpace *space;
+    int virtualPage;
+    FrameSharer *next;
+};
+
+// What is in one physical frame.
+
+class FrameEntry {
+  public:
+    AddrSpace *space;		// whose page is in the frame, or NULL
+    int virtualPage;		// which of its pages
+    int pinned;			// how many times the frame has been
+				// pinned, and not yet unpinned
+    FrameEntry *next, *prev;	// neighbours on a FrameQueue
+    bool queued;		// the frame is on a FrameQueue
+    bool inTransit;		// a page is being read into the frame,
+				// or written out of it
+    List *waiters;		// threads waiting for that to finish
+    bool zeroed;		// the frame is all zeros, and nothing
+				// has been put in it since
+    FrameSharer *sharers;	// other pages merged into the frame
+    unsigned int hash;		// the page's hash at the page merger's
+    bool hashed;		// last scan, if it has been hashed
+};
+
+// A queue of frames, for page replacement.  Frames can be taken out
+// of the middle as well as the front, since the queue is doubly
+// linked through the frame entries themselves.  A frame can be on
+// one queue at a time.
+
+class FrameQueue {
+  public:
+    FrameQueue();		// initialize an empty queue
+
+    void Append(FrameEntry *entry);	// put a frame at the end
+    void Remove(FrameEntry *entry);	// take it out, wherever it is
+    FrameEntry *First() { return first; }	// the front, or NULL
+
+  private:
+    FrameEntry *first, *last;
+};
+
+// The frame table.
+
+class FrameTable {
+  public:
+    FrameTable(int nframes);		// all frames start out empty
+    ~FrameTable();
+
+    FrameEntry *Entry(int frame) { return &frames[frame]; }
+    int FrameOf(FrameEntry *entry) { return entry - frames; }
+
+    void Map(int frame, AddrSpace *space, int virtualPage);
+					// "frame" now holds the page
+    void Unmap(int frame);		// "frame" no longer holds anything
+    void Pin(int frame);
+    void Unpin(int frame);
+    bool IsPinned(int frame) { return frames[frame].pinned > 0; }
+    bool AllPinned() { return numPinned == numFrames; }
+    void WaitForUnpin();		// sleep until a frame is unpinned
+
+    void StartTransfer(int frame);	// a page is being read into "frame",
+					// or written out of it
+    void FinishTransfer(int frame);	// it is done: wake the waiters
+    void WaitForTransfer(int frame);	// sleep until it is done
+
+    int FindFree(bool wantZeroed);	// allocate a free frame, zeroed or
+					// not if possible; -1 if none is free
+    bool UseZeroed(int frame);		// whether "frame" is zeroed, which
+					// it won't be once it is filled
+    void ZeroFreeFrames();		// zero the free frames, while idle
+
+    void Share(int frame, AddrSpace *space, int virtualPage);
+					// "frame" now holds that page too
+    bool Unshare(int frame, AddrSpace *space, int virtualPage);
+					// it no longer does, if it is shared
+    bool IsShared(int frame) { return frames[frame].sharers != NULL; }
+
+    TranslationEntry *PageTableEntry(int frame);
+					// the entry mapping "frame", with
+					// up to date use and dirty bits
+    bool IsUsed(int frame);		// any page in "frame" used since
+					// its use bit was cleared
+    bool IsDirty(int frame);		// any page in "frame" dirty
+    void ClearUse(int frame);		// clear all their use bits
+
+    FrameQueue loaded;			// mapped frames, in the order their
+					// pages were brought in
+
+  private:
+    FrameEntry *frames;			// one for each physical frame
+    int numFrames;
+    TranslationEntry *SharerEntry(FrameSharer *sharer);
+					// the entry mapping a sharer's page
+    int numPinned;			// frames that are pinned
+    List *unpinWaiters;			// threads waiting for a frame to
+					// be unpinned
+};
+
+#endif // FRAMETABLE_H
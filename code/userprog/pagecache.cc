@@ -0,0 +1,249 @@
+// pagecache.cc
+//	Routines for the page cache of programs' code.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "pagecache.h"
+
+//----------------------------------------------------------------------
+// PageCache::PageCache
+// 	Initialize an empty page cache.
+//
+//	"nframes" -- how many frames of physical memory there are
+//	"maxUnused" -- how many frames no page is using to keep; 0 means
+//		nothing is cached
+//----------------------------------------------------------------------
+
+PageCache::PageCache(int nframes, int maxUnused)
+{
+    ASSERT(maxUnused >= 0 && maxUnused <= nframes);
+    numFrames = nframes;
+    budget = maxUnused;
+    numUnused = 0;
+    programs = NULL;
+    program = new char *[numFrames];
+    page = new int[numFrames];
+    for (int i = 0; i < numFrames; i++) {
+	program[i] = NULL;
+	page[i] = -1;
+    }
+}
+
+//----------------------------------------------------------------------
+// PageCache::~PageCache
+// 	De-allocate the page cache.
+//----------------------------------------------------------------------
+
+PageCache::~PageCache()
+{
+    ProgramName *known;
+
+    while (programs != NULL) {
+	known = programs;
+	programs = known->next;
+	delete [] known->name;
+	delete known;
+    }
+    delete [] program;
+    delete [] page;
+}
+
+//----------------------------------------------------------------------
+// PageCache::Lookup
+// 	Return the entry for a program, or NULL if it is not known.
+//
+//	"name" -- the name of the program's executable
+//----------------------------------------------------------------------
+
+ProgramName *
+PageCache::Lookup(char *name)
+{
+    ProgramName *known;
+
+    for (known = programs; known != NULL; known = known->next)
+	if (known->name == name || strcmp(known->name, name) == 0)
+	    return known;
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// PageCache::Program
+// 	An address space is about to run a program.  Return the cache's
+//	copy of the program's name, so that every address space running
+//	the program has the same one, and its pages can be compared by
+//	pointer.  The address space calls Forget when it is done with it.
+//
+//	"name" -- the name of the program's executable
+//----------------------------------------------------------------------
+
+char *
+PageCache::Program(char *name)
+{
+    ProgramName *known = Lookup(name);
+
+    if (known == NULL) {
+	known = new ProgramName;
+	known->name = new char[strlen(name) + 1];
+	strcpy(known->name, name);
+	known->users = 0;
+	known->next = programs;
+	programs = known;
+    }
+    known->users++;
+    return known->name;
+}
+
+//----------------------------------------------------------------------
+// PageCache::Forget
+// 	An address space, or a cached frame, no longer uses a program's
+//	name.  Once nothing does, the name is dropped.
+//
+//	"name" -- the program, as returned by Program
+//----------------------------------------------------------------------
+
+void
+PageCache::Forget(char *name)
+{
+    ProgramName **prev, *known;
+
+    for (prev = &programs; *prev != NULL && (*prev)->name != name;
+	 prev = &(*prev)->next)
+	;
+    ASSERT(*prev != NULL);
+    known = *prev;
+    if (--known->users > 0)
+	return;
+    *prev = known->next;
+    delete [] known->name;
+    delete known;
+}
+
+//----------------------------------------------------------------------
+// PageCache::Find
+// 	Return the frame holding one of a program's pages, or -1 if it
+//	is not in the cache.
+//
+//	"name" -- the program, as returned by Program
+//	"virtualPage" -- the page
+//----------------------------------------------------------------------
+
+int
+PageCache::Find(char *name, int virtualPage)
+{
+    for (int frame = 0; frame < numFrames; frame++)
+	if (program[frame] == name && page[frame] == virtualPage)
+	    return frame;
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// PageCache::Enter
+// 	Record that a frame holds one of a program's pages, just read
+//	from its executable, to be found by Find.  The frame keeps the
+//	program's name until it is dropped from the cache.
+//
+//	"frame" -- the frame
+//	"name" -- the program, as returned by Program
+//	"virtualPage" -- the page
+//----------------------------------------------------------------------
+
+void
+PageCache::Enter(int frame, char *name, int virtualPage)
+{
+    ASSERT(Enabled() && program[frame] == NULL);
+    Lookup(name)->users++;
+    program[frame] = name;
+    page[frame] = virtualPage;
+}
+
+//----------------------------------------------------------------------
+// PageCache::Use
+// 	A page is about to be mapped to one of the unused frames: it is
+//	no longer a candidate for Reclaim.
+//
+//	"frame" -- the frame, which no page is using
+//----------------------------------------------------------------------
+
+void
+PageCache::Use(int frame)
+{
+    unused.Remove(frameTable->Entry(frame));
+    numUnused--;
+}
+
+//----------------------------------------------------------------------
+// PageCache::Release
+// 	The last page using a frame has been unmapped.  If the frame is
+//	in the cache, keep it, as the most recently used of the unused
+//	frames; if that makes too many, free the least recently used.
+//
+//	"frame" -- the frame
+//
+// Returns:
+//	FALSE, doing nothing, if the frame is not in the cache: the
+//	caller frees it.
+//----------------------------------------------------------------------
+
+bool
+PageCache::Release(int frame)
+{
+    int oldest;
+
+    if (!Holds(frame))
+	return FALSE;
+    unused.Append(frameTable->Entry(frame));
+    if (++numUnused > budget && (oldest = Reclaim()) != -1)
+	memMap->Clear(oldest);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// PageCache::Reclaim
+// 	Take the least recently used of the unused frames out of the
+//	cache, for another page.  It stays marked in use in memMap.
+//	Pinned frames are passed over: their data is still being copied.
+//
+// Returns:
+//	The frame, or -1 if there is no such frame.
+//----------------------------------------------------------------------
+
+int
+PageCache::Reclaim()
+{
+    FrameEntry *entry;
+    int frame;
+
+    for (entry = unused.First(); entry != NULL; entry = entry->next)
+	if (!entry->pinned)
+	    break;
+    if (entry == NULL)
+	return -1;
+    frame = frameTable->FrameOf(entry);
+    Use(frame);
+    Drop(frame);
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// PageCache::Drop
+// 	Forget the page a frame holds, if it is in the cache: the frame
+//	is being given to another page.
+//
+//	"frame" -- the frame, which no page may be using unless it is
+//		being evicted
+//----------------------------------------------------------------------
+
+void
+PageCache::Drop(int frame)
+{
+    if (!Holds(frame))
+	return;
+    Forget(program[frame]);
+    program[frame] = NULL;
+    page[frame] = -1;
+    stats->numPageCacheDrops++;
+}
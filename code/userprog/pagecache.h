@@ -0,0 +1,91 @@
+// pagecache.h
+//	Data structures for the page cache: frames holding pages of the
+//	code of programs, shared by every address space running the same
+//	program, and kept after the last of them exits.
+//
+//	Only pages that hold nothing but code are cached, since nothing
+//	ever writes to them.  A cached page is mapped read-only; if a
+//	program does write to it, it gets its own copy (see
+//	AddrSpace::CopyOnWrite).  A page that has ever been written to
+//	swap is never looked for in the cache.
+//
+//	A cached frame is used by pages of address spaces like any other
+//	frame, listed in the frame table as for a shared frame, and can be
+//	evicted, which drops it from the cache.  When the last page using
+//	it goes away, the frame is kept, unused, still marked in use in
+//	memMap, so that the next process to run the program finds its
+//	code already in memory.  Only so many unused pages are kept: past
+//	that, the least recently used one is freed.  A page fault that
+//	finds no free frame takes the least recently used one too, before
+//	any page is evicted.
+//
+//	Programs are known by the name of their executable.  A name is
+//	kept while any address space is running the program, or any
+//	cached frame holds one of its pages.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PAGECACHE_H
+#define PAGECACHE_H
+
+#include "copyright.h"
+#include "frametable.h"
+
+#define PageCachePages		8	// by default, how many pages no
+					// process is using are kept
+
+// The name of a program known to the page cache.
+
+class ProgramName {
+  public:
+    char *name;
+    int users;			// address spaces running the program, and
+				// cached frames holding its pages
+    ProgramName *next;		// next on the cache's list
+};
+
+class PageCache {
+  public:
+    PageCache(int nframes, int maxUnused);
+					// an empty cache, keeping up to
+					// "maxUnused" unused pages; 0
+					// turns it off
+    ~PageCache();
+
+    bool Enabled() { return budget > 0; }
+    char *Program(char *name);		// an address space is running the
+					// program called "name"; returns
+					// it, for Find and Enter
+    void Forget(char *name);		// and no longer is
+    int Find(char *name, int virtualPage);
+					// the frame holding a page of the
+					// program's, or -1
+    void Enter(int frame, char *name, int virtualPage);
+					// "frame" holds that page now
+    bool Holds(int frame) { return program[frame] != NULL; }
+    void Use(int frame);		// an unused cached frame is wanted
+    bool Release(int frame);		// the last page using a cached
+					// frame has gone: keep it unused
+    int Reclaim();			// take back the least recently used
+					// unused frame, or -1 if there is none
+    void Drop(int frame);		// forget what "frame" holds, if it
+					// is in the cache
+
+  private:
+    int numFrames;
+    int budget;				// the most unused frames to keep
+    int numUnused;			// how many there are
+    FrameQueue unused;			// and which, least recently used
+					// first
+    ProgramName *programs;		// the names of programs in use
+    char **program;			// the program each frame holds a
+					// page of, or NULL
+    int *page;				// and which page of it
+
+    ProgramName *Lookup(char *name);	// the program called "name", or
+					// NULL
+};
+
+#endif // PAGECACHE_H
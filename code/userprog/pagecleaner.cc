@@ -0,0 +1,162 @@
+// pagecleaner.cc
+//	Routines for the page cleaner thread.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "pagecleaner.h"
+#include "addrspace.h"
+
+//----------------------------------------------------------------------
+// CleanerThread
+// 	The page cleaner thread.  Need this to be a C routine, because
+//	C++ can't handle pointers to member functions.
+//----------------------------------------------------------------------
+
+static void
+CleanerThread(int arg)
+{
+    PageCleaner *cleaner = (PageCleaner *) arg;
+
+    cleaner->Run();
+}
+
+//----------------------------------------------------------------------
+// PageCleaner::PageCleaner
+// 	Initialize the page cleaner.  Its thread is not started yet.
+//
+//	"lowWater" -- wake the cleaner when fewer frames than this are
+//		clean; 0 means never
+//	"highWater" -- how many frames ahead of page replacement to clean
+//----------------------------------------------------------------------
+
+PageCleaner::PageCleaner(int lowWater, int highWater)
+{
+    ASSERT(lowWater >= 0 && highWater >= lowWater
+	   && highWater <= NumPhysPages);
+    low = lowWater;
+    high = highWater;
+    wakeup = new Semaphore("page cleaner", 0);
+    awake = FALSE;
+    thread = NULL;
+}
+
+//----------------------------------------------------------------------
+// PageCleaner::~PageCleaner
+// 	De-allocate the page cleaner.  Its thread is never finished; it
+//	is asleep, and goes when Nachos does.
+//----------------------------------------------------------------------
+
+PageCleaner::~PageCleaner()
+{
+    delete wakeup;
+}
+
+//----------------------------------------------------------------------
+// PageCleaner::Check
+// 	Called at a page fault, once the faulting page has its frame.
+//	If too few frames are clean, wake the cleaner up, starting its
+//	thread the first time.  It runs once the faulting thread waits
+//	for the disk, or its time slice is up.
+//----------------------------------------------------------------------
+
+void
+PageCleaner::Check()
+{
+    if (low == 0 || awake || memMap->NumClear() + CleanAhead(low) >= low)
+	return;
+    awake = TRUE;
+    if (thread == NULL) {
+	thread = new Thread("page cleaner");
+	thread->Fork(CleanerThread, (int) this);
+    }
+    wakeup->V();
+}
+
+//----------------------------------------------------------------------
+// PageCleaner::Run
+// 	The cleaner thread.  Each time it is woken up, go through the
+//	next "high" frames in replacement order, starting writes of the
+//	dirty pages in batches of CleanerBatch, and waiting for each
+//	batch to finish (swap requests are done in order, so the last
+//	write of the batch is the last to finish).  Frames that are
+//	pinned or shared are passed over (a shared frame is written
+//	once for all its pages, when it is evicted), and so are pages
+//	used since their use bits were last cleared: they would most
+//	likely just be dirtied again.  (FIFO replacement never clears
+//	use bits, so with it only pages untouched since they were
+//	brought in are cleaned.)
+//
+//	With a TLB, a page's dirty bit may be in its TLB entry, which
+//	FrameTable::PageTableEntry writes back.
+//----------------------------------------------------------------------
+
+void
+PageCleaner::Run()
+{
+    int order[NumPhysPages];
+    int i, seen, frame, last, written;
+    FrameEntry *entry;
+    TranslationEntry *pte;
+
+    for (;;) {
+	wakeup->P();
+	AddrSpace::ReplacementOrder(order);
+	for (i = seen = 0; i < NumPhysPages && seen < high; ) {
+	    written = 0;
+	    for (; i < NumPhysPages && seen < high
+		   && written < CleanerBatch; i++) {
+		frame = order[i];
+		entry = frameTable->Entry(frame);
+		if (entry->space == NULL || frameTable->IsPinned(frame)
+		    || frameTable->IsShared(frame))
+		    continue;
+		seen++;
+		pte = frameTable->PageTableEntry(frame);
+		if (!pte->dirty || pte->use)
+		    continue;
+		entry->space->StartClean(entry->virtualPage, frame);
+		last = frame;
+		written++;
+	    }
+	    if (written == 0)
+		continue;
+	    stats->numCleanerWrites += written;
+	    stats->numCleanerBatches++;
+	    frameTable->WaitForTransfer(last);
+	}
+	awake = FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// PageCleaner::CleanAhead
+// 	Count the clean frames among the next "n" that page replacement
+//	will look at (pinned frames, which it passes over, are not
+//	counted).  Dirty bits still in the TLB are not looked at, so
+//	this may count a few too many.
+//
+//	"n" -- how many frames to look at
+//----------------------------------------------------------------------
+
+int
+PageCleaner::CleanAhead(int n)
+{
+    int order[NumPhysPages];
+    int seen = 0, clean = 0;
+    FrameEntry *entry;
+
+    AddrSpace::ReplacementOrder(order);
+    for (int i = 0; i < NumPhysPages && seen < n; i++) {
+	entry = frameTable->Entry(order[i]);
+	if (entry->space == NULL || frameTable->IsPinned(order[i]))
+	    continue;
+	seen++;
+	if (!entry->space->getPageTableEntry(entry->virtualPage)->dirty)
+	    clean++;
+    }
+    return clean;
+}
@@ -0,0 +1,56 @@
+// pagecleaner.h
+//	Data structures for the page cleaner: a kernel thread that writes
+//	dirty pages to swap ahead of their eviction, so that a page fault
+//	almost always finds a clean victim, and need not wait for a write
+//	before it can start reading its own page.
+//
+//	There is no list of free frames to keep stocked: once memory is
+//	full, the next frame to be reused is whichever page replacement
+//	picks.  So the watermarks are on the frames next in line.  When
+//	a page fault leaves fewer than the low watermark of clean frames
+//	-- free ones, or ones among the next "low" that replacement will
+//	look at whose pages are not dirty -- the cleaner is woken up.
+//	It goes through the next "high" frames in replacement order, and
+//	writes the dirty pages that are not in active use in batches,
+//	leaving them mapped with their dirty bits cleared.
+//
+//	The thread is only started the first time it is needed.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PAGECLEANER_H
+#define PAGECLEANER_H
+
+#include "copyright.h"
+#include "synch.h"
+
+#define CleanerLow		4	// by default, wake the cleaner when
+					// fewer frames than this are clean
+#define CleanerHigh		8	// and clean this many frames ahead
+#define CleanerBatch		4	// pages written at a time
+
+class PageCleaner {
+  public:
+    PageCleaner(int lowWater, int highWater);
+					// set the watermarks; a low
+					// watermark of 0 turns cleaning off
+    ~PageCleaner();
+
+    void Check();			// after a page fault: wake the
+					// cleaner if it is needed
+    void Run();			// the cleaner thread's body
+
+  private:
+    int low, high;			// the watermarks
+    Semaphore *wakeup;			// the cleaner has something to do
+    bool awake;				// it is already doing it
+    Thread *thread;			// the cleaner, or NULL if it has not
+					// been needed yet
+
+    int CleanAhead(int n);		// how many of the next "n" frames
+					// to be replaced are clean
+};
+
+#endif // PAGECLEANER_H
@@ -0,0 +1,198 @@
+// pagemerger.cc
+//	Routines for the page merger thread.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "pagemerger.h"
+#include "addrspace.h"
+
+// Pages are hashed 16 bytes at a time, as four words side by side,
+// with GCC's vector extensions; the compiler uses the host's vector
+// instructions for them, if it has any.
+
+typedef unsigned int HashVector __attribute__ ((vector_size (16)));
+
+#define HashMultiplier	0x01000193	// the FNV prime
+
+//----------------------------------------------------------------------
+// HashPage
+// 	Hash the contents of a frame.  Each lane of the vector hashes
+//	every fourth word of the page; the lanes are combined at the end.
+//	(Memory need not be aligned for vectors, so each is copied.)
+//
+//	"frame" -- the frame
+//----------------------------------------------------------------------
+
+static unsigned int
+HashPage(int frame)
+{
+    char *page = machine->mainMemory + frame * PageSize;
+    HashVector multiplier = { HashMultiplier, HashMultiplier,
+			      HashMultiplier, HashMultiplier };
+    HashVector hash = { 1, 2, 3, 4 };
+    HashVector words;
+    unsigned int lanes[4];
+
+    for (int i = 0; i < PageSize; i += sizeof(HashVector)) {
+	memcpy(&words, page + i, sizeof(HashVector));
+	hash = hash * multiplier + words;
+    }
+    memcpy(lanes, &hash, sizeof(lanes));
+    return ((lanes[0] * HashMultiplier + lanes[1]) * HashMultiplier
+	    + lanes[2]) * HashMultiplier + lanes[3];
+}
+
+//----------------------------------------------------------------------
+// MergerThread
+// 	The page merger thread.  Need this to be a C routine, because
+//	C++ can't handle pointers to member functions.
+//----------------------------------------------------------------------
+
+static void
+MergerThread(int arg)
+{
+    PageMerger *merger = (PageMerger *) arg;
+
+    merger->Run();
+}
+
+//----------------------------------------------------------------------
+// PageMerger::PageMerger
+// 	Initialize the page merger.  Its thread is not started yet.
+//
+//	"faultInterval" -- how many page faults to wait between scans; 0
+//		means never
+//----------------------------------------------------------------------
+
+PageMerger::PageMerger(int faultInterval)
+{
+    ASSERT(faultInterval >= 0);
+    interval = faultInterval;
+    faults = 0;
+    wakeup = new Semaphore("page merger", 0);
+    awake = FALSE;
+    thread = NULL;
+}
+
+//----------------------------------------------------------------------
+// PageMerger::~PageMerger
+// 	De-allocate the page merger.  Its thread is never finished; it
+//	is asleep, and goes when Nachos does.
+//----------------------------------------------------------------------
+
+PageMerger::~PageMerger()
+{
+    delete wakeup;
+}
+
+//----------------------------------------------------------------------
+// PageMerger::Check
+// 	Called at a page fault.  Every "interval" faults, if memory is
+//	full, wake the merger up, starting its thread the first time.
+//	When memory is not full, there is nothing to gain.
+//----------------------------------------------------------------------
+
+void
+PageMerger::Check()
+{
+    if (interval == 0 || awake || ++faults < interval
+	|| memMap->NumClear() > 0)
+	return;
+    faults = 0;
+    awake = TRUE;
+    if (thread == NULL) {
+	thread = new Thread("page merger");
+	thread->Fork(MergerThread, (int) this);
+    }
+    wakeup->V();
+}
+
+//----------------------------------------------------------------------
+// PageMerger::Run
+// 	The merger thread.  Each time it is woken up, hash every frame.
+//	A frame whose hash has not changed since the last scan is stable,
+//	and is compared with the stable frames before it that have the
+//	same hash; if one holds the same data, the page is merged into
+//	it.  Frames already holding shared pages (merged, or since a
+//	Fork) are read-only, so they are always stable, and so are frames
+//	in the page cache, which must stay where they are; they are
+//	hashed anew at each scan, since they may have become shared or
+//	cached since they were last hashed.  Pinned frames are passed
+//	over, and no page is merged into one.
+//
+//	The thread does not give up the CPU during a scan, so nothing
+//	changes a page between its comparison and its merging.
+//----------------------------------------------------------------------
+
+void
+PageMerger::Run()
+{
+    int stable[NumPhysPages];
+    int numStable, frame, i;
+    unsigned int hash;
+    FrameEntry *entry;
+
+    for (;;) {
+	wakeup->P();
+	stats->numMergeScans++;
+	numStable = 0;
+	for (frame = 0; frame < NumPhysPages; frame++) {
+	    entry = frameTable->Entry(frame);
+	    if (entry->space == NULL)
+		continue;
+	    if (frameTable->IsPinned(frame)) {
+		entry->hashed = FALSE;	// it is being filled, or written
+		continue;
+	    }
+	    hash = HashPage(frame);
+	    if (frameTable->IsShared(frame) || pageCache->Holds(frame)) {
+		entry->hash = hash;	// read-only: stable as it is
+		entry->hashed = TRUE;
+		stable[numStable++] = frame;
+		continue;
+	    }
+	    if (!entry->hashed || entry->hash != hash) {
+		entry->hash = hash;	// changed: wait for the next scan
+		entry->hashed = TRUE;
+		continue;
+	    }
+	    for (i = 0; i < numStable; i++)
+		if (frameTable->Entry(stable[i])->hash == hash
+		    && memcmp(machine->mainMemory + frame * PageSize,
+			      machine->mainMemory + stable[i] * PageSize,
+			      PageSize) == 0)
+		    break;
+	    if (i < numStable)
+		Merge(frame, stable[i]);
+	    else
+		stable[numStable++] = frame;
+	}
+	awake = FALSE;
+    }
+}
+
+//----------------------------------------------------------------------
+// PageMerger::Merge
+// 	Map the page in one frame to another frame holding the same
+//	data, and free the first frame.  If the second frame is not
+//	shared yet, its own page becomes read-only too.
+//
+//	"frame" -- the frame to free
+//	"into" -- the frame to keep
+//----------------------------------------------------------------------
+
+void
+PageMerger::Merge(int frame, int into)
+{
+    FrameEntry *from = frameTable->Entry(frame);
+    FrameEntry *to = frameTable->Entry(into);
+
+    if (!frameTable->IsShared(into))
+	to->space->setReadOnly(to->virtualPage, TRUE);
+    from->space->MergePage(from->virtualPage, into);
+    stats->numPagesMerged++;
+}
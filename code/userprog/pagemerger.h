@@ -0,0 +1,54 @@
+// pagemerger.h
+//	Data structures for the page merger: a kernel thread that finds
+//	frames holding the same data -- pages of the same program run by
+//	several processes, or pages that are still all zeros -- and keeps
+//	just one copy of each.
+//
+//	The other pages are mapped to the copy that is kept, read-only,
+//	and their frames are freed.  A frame holding merged pages has one
+//	page (the frame table's) and a list of the others.  When one of
+//	them is written to, the write fails with a ReadOnlyException, and
+//	the page is given its own copy again (see AddrSpace::CopyOnWrite).
+//
+//	Pages are compared by hashing them; a page is only merged if its
+//	hash is the same as at the last scan, since a page that is being
+//	changed would soon be copied back out.  The merger is woken every
+//	so many page faults while memory is full.
+//
+//	The thread is only started the first time it is needed.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PAGEMERGER_H
+#define PAGEMERGER_H
+
+#include "copyright.h"
+#include "synch.h"
+
+#define MergeInterval		16	// by default, scan memory every this
+					// many page faults
+
+class PageMerger {
+  public:
+    PageMerger(int faultInterval);	// scan every "faultInterval" faults;
+					// 0 turns merging off
+    ~PageMerger();
+
+    void Check();			// at a page fault: wake the merger
+					// if it is time
+    void Run();				// the merger thread's body
+
+  private:
+    int interval;
+    int faults;				// faults since the last scan
+    Semaphore *wakeup;			// the merger has something to do
+    bool awake;				// it is already doing it
+    Thread *thread;			// the merger, or NULL if it has not
+					// been needed yet
+
+    void Merge(int frame, int into);	// map the page in "frame" to "into"
+};
+
+#endif // PAGEMERGER_H
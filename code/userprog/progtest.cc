@@ -23,10 +23,6 @@
 void
 StartProcess(char *filename)
 {
-	pageLock = new Semaphore*[NumPhysPages];
-	for(int j = 0; j < NumPhysPages; j++)
-		pageLock[j] = new Semaphore((char*)'A', 1);
-	
     OpenFile *executable = fileSystem->Open(filename);
 	
     AddrSpace *space;
@@ -50,11 +46,20 @@ StartProcess(char *filename)
 		printf("FIFO Page Replacement.\n");
 	else if (swapChoice == 2)
 		printf("Random Page Replacement.\n");
+	else if (swapChoice == 3)
+		printf("Clock Page Replacement.\n");
+	else if (swapChoice == 4)
+		printf("Enhanced Second-Chance Page Replacement.\n");
+	else if (swapChoice == 5)
+		printf("WSClock Page Replacement.\n");
 	else
 		printf("Demand Paging Only. (default)\n");
 	
-    space = new AddrSpace(executable);    
+    space = new AddrSpace(executable, filename);
     currentThread->space = space;
+    if (profiler != NULL)
+	space->profile = profiler->NewProfile(filename, 
+					space->getNumPages() * PageSize);
 
     //delete executable;			// close file
 
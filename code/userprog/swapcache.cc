@@ -0,0 +1,261 @@
+// swapcache.cc
+//	Routines to compress pages, and to keep them in the swap cache.
+//
+//	A compressed page is a list of records, each starting with a
+//	byte n:
+//
+//	    n < RunFlag: n + 1 words follow, as they are;
+//	    n >= RunFlag: a word and a difference follow, standing for a
+//		run of n - RunFlag + MinRun words, each the one before it
+//		plus the difference.
+//
+//	Words are in host byte order, since they never leave the machine.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "swapcache.h"
+
+#define RunFlag		128		// a record byte this big starts a run
+#define MinRun		3		// shorter runs are not worth a record
+#define MaxRun		(255 - RunFlag + MinRun)
+#define WordsPerPage	(PageSize / (int) sizeof(unsigned int))
+
+//----------------------------------------------------------------------
+// SwapCache::SwapCache
+// 	Initialize an empty swap cache.
+//
+//	"nslots" -- how many slots the swap device has
+//	"bytes" -- how many bytes of compressed pages the pool can hold
+//----------------------------------------------------------------------
+
+SwapCache::SwapCache(int nslots, int bytes)
+{
+    numSlots = nslots;
+    capacity = bytes;
+    used = 0;
+    pages = new CachedPage *[numSlots];
+    for (int i = 0; i < numSlots; i++)
+	pages[i] = NULL;
+    coldest = hottest = NULL;
+    // the worst case: every word on its own, with a record byte for
+    // every RunFlag of them
+    buffer = new char[PageSize + WordsPerPage / RunFlag + 1];
+    bufferSize = 0;
+}
+
+//----------------------------------------------------------------------
+// SwapCache::~SwapCache
+// 	De-allocate the swap cache, and the pages in it.
+//----------------------------------------------------------------------
+
+SwapCache::~SwapCache()
+{
+    for (int i = 0; i < numSlots; i++)
+	Drop(i);
+    delete [] pages;
+    delete [] buffer;
+}
+
+//----------------------------------------------------------------------
+// SwapCache::Compress
+// 	Compress a page into the cache's buffer, for Store.  Each run of
+//	MinRun or more words going up (or down) by the same amount is
+//	found as we go; the words in between are copied.
+//
+//	"page" -- the page, PageSize bytes
+//
+// Returns:
+//	The size of the compressed page, or -1 if it is not smaller than
+//	the page, or could never fit in the pool.
+//----------------------------------------------------------------------
+
+int
+SwapCache::Compress(char *page)
+{
+    unsigned int *words = (unsigned int *) page;
+    unsigned char *out = (unsigned char *) buffer;
+    unsigned int difference;
+    int i, run, n = 0, literal = -1;
+
+    for (i = 0; i < WordsPerPage; i += run) {
+	run = 1;
+	if (i + 1 < WordsPerPage) {
+	    difference = words[i + 1] - words[i];
+	    for (run = 2; i + run < WordsPerPage && run < MaxRun
+		    && words[i + run] - words[i + run - 1] == difference; run++)
+		;
+	}
+	if (run >= MinRun) {
+	    out[n++] = RunFlag + run - MinRun;
+	    memcpy(&out[n], &words[i], sizeof(unsigned int));
+	    memcpy(&out[n + 4], &difference, sizeof(unsigned int));
+	    n += 8;
+	    literal = -1;
+	} else {			// just the one word
+	    run = 1;
+	    if (literal == -1 || out[literal] == RunFlag - 1) {
+		literal = n++;
+		out[literal] = 0;
+	    } else
+		out[literal]++;
+	    memcpy(&out[n], &words[i], sizeof(unsigned int));
+	    n += 4;
+	}
+    }
+    bufferSize = n;
+    if (n >= PageSize || n > capacity)
+	return -1;
+    return n;
+}
+
+//----------------------------------------------------------------------
+// SwapCache::Store
+// 	Keep the page Compress has just compressed as a slot's contents,
+//	at the hot end of the list.  The caller must make room for it
+//	first, and drop what the slot held before.
+//
+//	"slot" -- the slot
+//----------------------------------------------------------------------
+
+void
+SwapCache::Store(int slot)
+{
+    CachedPage *page = new CachedPage;
+
+    ASSERT(slot >= 0 && slot < numSlots && pages[slot] == NULL);
+    ASSERT(Fits(bufferSize));
+    page->slot = slot;
+    page->data = new char[bufferSize];
+    memcpy(page->data, buffer, bufferSize);
+    page->size = bufferSize;
+    pages[slot] = page;
+    used += bufferSize;
+    Append(page);
+}
+
+//----------------------------------------------------------------------
+// SwapCache::Load
+// 	If a slot's page is cached, decompress it.  It is kept, since the
+//	slot is not written to the disk, but it is made the coldest page:
+//	it is in memory now.
+//
+//	"slot" -- the slot
+//	"page" -- where the page goes, PageSize bytes
+//
+// Returns:
+//	Whether the page was cached.
+//----------------------------------------------------------------------
+
+bool
+SwapCache::Load(int slot, char *page)
+{
+    CachedPage *cached = pages[slot];
+    unsigned char *in;
+    unsigned int *words = (unsigned int *) page;
+    unsigned int word, difference;
+    int i = 0, n = 0, count;
+
+    if (cached == NULL)
+	return FALSE;
+    in = (unsigned char *) cached->data;
+    while (n < cached->size) {
+	if (in[n] >= RunFlag) {
+	    count = in[n] - RunFlag + MinRun;
+	    memcpy(&word, &in[n + 1], sizeof(unsigned int));
+	    memcpy(&difference, &in[n + 5], sizeof(unsigned int));
+	    n += 9;
+	    for (; count > 0; count--, word += difference)
+		words[i++] = word;
+	} else {
+	    count = in[n] + 1;
+	    memcpy(&words[i], &in[n + 1], count * sizeof(unsigned int));
+	    n += 1 + count * sizeof(unsigned int);
+	    i += count;
+	}
+    }
+    ASSERT(i == WordsPerPage);
+    Remove(cached);
+    Prepend(cached);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// SwapCache::Drop
+// 	Forget a slot's page, if it is cached: it has been written over,
+//	or written back to the disk, or the slot has been freed.
+//
+//	"slot" -- the slot
+//----------------------------------------------------------------------
+
+void
+SwapCache::Drop(int slot)
+{
+    CachedPage *page = pages[slot];
+
+    if (page == NULL)
+	return;
+    Remove(page);
+    used -= page->size;
+    pages[slot] = NULL;
+    delete [] page->data;
+    delete page;
+}
+
+//----------------------------------------------------------------------
+// SwapCache::Coldest
+// 	Return the slot whose page should be written back first, or -1
+//	if nothing is cached.
+//----------------------------------------------------------------------
+
+int
+SwapCache::Coldest()
+{
+    return (coldest == NULL) ? -1 : coldest->slot;
+}
+
+//----------------------------------------------------------------------
+// SwapCache::Append, Prepend, Remove
+// 	Put a cached page on the hot or the cold end of the list, or
+//	take it off.
+//----------------------------------------------------------------------
+
+void
+SwapCache::Append(CachedPage *page)
+{
+    page->next = NULL;
+    page->prev = hottest;
+    if (hottest == NULL)
+	coldest = page;
+    else
+	hottest->next = page;
+    hottest = page;
+}
+
+void
+SwapCache::Prepend(CachedPage *page)
+{
+    page->prev = NULL;
+    page->next = coldest;
+    if (coldest == NULL)
+	hottest = page;
+    else
+	coldest->prev = page;
+    coldest = page;
+}
+
+void
+SwapCache::Remove(CachedPage *page)
+{
+    if (page->prev == NULL)
+	coldest = page->next;
+    else
+	page->prev->next = page->next;
+    if (page->next == NULL)
+	hottest = page->prev;
+    else
+	page->next->prev = page->prev;
+}
@@ -0,0 +1,77 @@
+// swapcache.h
+//	Data structures for the swap cache: a pool of compressed pages,
+//	kept in host memory (outside the machine's main memory), in front
+//	of the swap disk.
+//
+//	The cache holds the contents of swap slots.  A page written to a
+//	slot is compressed and kept here instead of being written to the
+//	disk, if it compresses to less than a page; reading the slot then
+//	just decompresses it.  The pool is limited in size.  When it is
+//	full, its coldest pages are written back to their slots on the
+//	disk, to make room.  A page that has just been read from the cache
+//	is back in memory, and will not be wanted again until it is next
+//	evicted, so it counts as the coldest.
+//
+//	User pages compress well: they are mostly runs of equal words
+//	(zeros, most often), or of words going up or down by the same
+//	amount each time (array indices, or arrays filled in order).  So
+//	a page is compressed as a list of runs like that, and of words
+//	that are not part of one.
+//
+//	The swap device is the only user of the cache; see swapdevice.cc.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SWAPCACHE_H
+#define SWAPCACHE_H
+
+#include "copyright.h"
+
+#define SwapCachePercent	25	// by default, the pool can hold this
+					// much of the size of main memory
+
+// A slot's page, compressed.
+
+class CachedPage {
+  public:
+    int slot;			// whose page it is
+    char *data;			// the compressed page
+    int size;			// how many bytes of it there are
+    CachedPage *next, *prev;	// neighbours on the list of cached pages,
+				// coldest first
+};
+
+class SwapCache {
+  public:
+    SwapCache(int nslots, int bytes);	// an empty cache for "nslots" slots,
+					// holding up to "bytes" bytes
+    ~SwapCache();
+
+    int Compress(char *page);		// compress a page, returning its size,
+					// or -1 if it cannot be cached
+    void Store(int slot);		// keep the page just compressed as
+					// the slot's contents
+    bool Load(int slot, char *page);	// decompress the slot's page, if
+					// it is cached
+    void Drop(int slot);		// forget the slot's page, if any
+    int Coldest();			// the slot cached longest ago, or -1
+    bool Fits(int size)			// room for "size" more bytes?
+	{ return used + size <= capacity; }
+
+  private:
+    CachedPage **pages;			// each slot's page, or NULL
+    int numSlots;
+    int capacity;			// the most bytes the pool can hold
+    int used;				// and how many it holds now
+    CachedPage *coldest, *hottest;	// the ends of the list
+    char *buffer;			// the last page compressed
+    int bufferSize;
+
+    void Append(CachedPage *page);	// put a page at the hot end
+    void Prepend(CachedPage *page);	// or at the cold end
+    void Remove(CachedPage *page);	// take it off the list
+};
+
+#endif // SWAPCACHE_H
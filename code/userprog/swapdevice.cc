@@ -0,0 +1,491 @@
+// swapdevice.cc
+//	Routines to allocate swap slots, and to read and write pages in
+//	them.  A page takes PageSize / SectorSize consecutive sectors;
+//	slot i starts at sector i * that.
+//
+//	The disk can do one sector at a time.  Requests wait their turn
+//	on a queue; the disk interrupt handler starts each sector when
+//	the one before it is done, and calls a request's "whenDone"
+//	function when all of its sectors are.  (SynchDisk uses a lock for
+//	this, but Lock is not implemented, and a semaphore would let a late
+//	request get ahead of one that has been waiting.)
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "swapdevice.h"
+
+#define SectorsPerSlot	(PageSize / SectorSize)
+
+//----------------------------------------------------------------------
+// SwapRequestDone
+// 	Swap disk interrupt handler.  Need this to be a C routine, because
+//	C++ can't handle pointers to member functions.
+//----------------------------------------------------------------------
+
+static void
+SwapRequestDone(int arg)
+{
+    SwapDevice *device = (SwapDevice *) arg;
+
+    device->RequestDone();
+}
+
+//----------------------------------------------------------------------
+// WakeUp
+// 	"whenDone" function for a synchronous request: the thread that
+//	made it can run again.
+//----------------------------------------------------------------------
+
+static void
+WakeUp(int arg)
+{
+    scheduler->ReadyToRun((Thread *) arg);
+}
+
+//----------------------------------------------------------------------
+// WriteBackDone
+// 	"whenDone" function for a page written back from the cache: the
+//	copy it was written from can go.
+//----------------------------------------------------------------------
+
+static void
+WriteBackDone(int arg)
+{
+    delete [] (char *) arg;
+}
+
+//----------------------------------------------------------------------
+// SwapDevice::SwapDevice
+// 	Initialize the swap device, and the raw disk under it.  Nothing
+//	on the disk is kept from an earlier run, so every slot is free.
+//
+//	"name" -- UNIX file name to be used as storage for the swap disk
+//	"cacheSize" -- how many bytes of compressed pages to keep in
+//		front of the disk; 0 means no cache
+//----------------------------------------------------------------------
+
+SwapDevice::SwapDevice(char *name, int cacheSize)
+{
+    ASSERT(PageSize % SectorSize == 0);
+    numSlots = NumSectors / SectorsPerSlot;
+    slots = new BitMap(numSlots);
+    users = new int[numSlots];
+    current = NULL;
+    queue = new List;
+    disk = new Disk(name, SwapRequestDone, (int) this);
+    cache = (cacheSize > 0) ? new SwapCache(numSlots, cacheSize) : NULL;
+}
+
+//----------------------------------------------------------------------
+// SwapDevice::~SwapDevice
+// 	De-allocate the swap device.
+//----------------------------------------------------------------------
+
+SwapDevice::~SwapDevice()
+{
+    if (cache != NULL)
+	delete cache;
+    delete disk;
+    delete queue;
+    delete slots;
+    delete [] users;
+}
+
+//----------------------------------------------------------------------
+// SwapDevice::AllocateSlot
+// 	Find a free slot, and mark it in use.
+//
+// Returns:
+//	The slot, or -1 if the swap device is full.
+//----------------------------------------------------------------------
+
+int
+SwapDevice::AllocateSlot()
+{
+    int slot = slots->Find();
+
+    if (slot != -1)
+	users[slot] = 1;
+    return slot;
+}
+
+//----------------------------------------------------------------------
+// SwapDevice::AllocateSlots
+// 	Find "count" consecutive free slots, and mark them in use.  The
+//	first run of them is taken.
+//
+//	"count" -- how many slots are wanted
+//
+// Returns:
+//	The first of the slots, or -1 if there is no such run.
+//----------------------------------------------------------------------
+
+int
+SwapDevice::AllocateSlots(int count)
+{
+    int first, run = 0;
+
+    for (first = 0; first + run < numSlots; ) {
+	if (slots->Test(first + run)) {
+	    first += run + 1;
+	    run = 0;
+	} else if (++run == count) {
+	    for (int i = 0; i < count; i++) {
+		slots->Mark(first + i);
+		users[first + i] = 1;
+	    }
+	    return first;
+	}
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// SwapDevice::ShareSlot
+// 	Record that another page is using a slot, with the same data.
+//
+//	"slot" -- the slot, which must be in use
+//----------------------------------------------------------------------
+
+void
+SwapDevice::ShareSlot(int slot)
+{
+    ASSERT(slot >= 0 && slot < numSlots && slots->Test(slot));
+    users[slot]++;
+}
+
+//----------------------------------------------------------------------
+// SwapDevice::FreeSlot
+// 	A page is no longer using a slot.  If it was the last one, mark
+//	the slot free, for someone else's page.
+//
+//	"slot" -- the slot, which must be in use
+//----------------------------------------------------------------------
+
+void
+SwapDevice::FreeSlot(int slot)
+{
+    ASSERT(slot >= 0 && slot < numSlots && slots->Test(slot));
+    if (--users[slot] > 0)
+	return;
+    slots->Clear(slot);
+    if (cache != NULL)
+	cache->Drop(slot);
+}
+
+//----------------------------------------------------------------------
+// SwapDevice::ReadSlot
+// 	Read the page in a slot into a buffer.  Return only after the
+//	data has been read.
+//
+//	"slot" -- the slot to read
+//	"data" -- where the page goes, PageSize bytes
+//----------------------------------------------------------------------
+
+void
+SwapDevice::ReadSlot(int slot, char *data)
+{
+    if (!ReadCached(slot, data))
+	Transfer(slot, 1, &data, FALSE);
+}
+
+//----------------------------------------------------------------------
+// SwapDevice::WriteSlot
+// 	Write a page into a slot.  Return only after the data has been
+//	written.
+//
+//	"slot" -- the slot to write
+//	"data" -- the page, PageSize bytes
+//----------------------------------------------------------------------
+
+void
+SwapDevice::WriteSlot(int slot, char *data)
+{
+    if (!WriteCached(slot, data))
+	Transfer(slot, 1, &data, TRUE);
+}
+
+//----------------------------------------------------------------------
+// SwapDevice::WriteSlots
+// 	Write several pages into consecutive slots, as one request (or,
+//	if the cache takes some of them, one for each run of the rest).
+//	Return only after they have all been written.
+//
+//	"slot" -- the first slot to write
+//	"count" -- how many pages there are
+//	"pages" -- the pages, PageSize bytes each, in slot order
+//----------------------------------------------------------------------
+
+void
+SwapDevice::WriteSlots(int slot, int count, char **pages)
+{
+    bool *cached = new bool[count];
+    int first, last;
+
+    for (int i = 0; i < count; i++)
+	cached[i] = WriteCached(slot + i, pages[i]);
+    for (first = 0; first < count; first = last) {
+	if (cached[first]) {
+	    last = first + 1;
+	    continue;
+	}
+	for (last = first + 1; last < count && !cached[last]; last++)
+	    ;
+	Transfer(slot + first, last - first, pages + first, TRUE);
+    }
+    delete [] cached;
+}
+
+//----------------------------------------------------------------------
+// SwapDevice::StartRead
+// 	Start reading the page in a slot into a buffer, and return at
+//	once.  "whenDone" is called by the interrupt handler once the
+//	data has been read.
+//
+//	"slot" -- the slot to read
+//	"data" -- where the page goes, PageSize bytes
+//	"whenDone", "whenDoneArg" -- what to call when it is there
+//----------------------------------------------------------------------
+
+void
+SwapDevice::StartRead(int slot, char *data, VoidFunctionPtr whenDone,
+		      int whenDoneArg)
+{
+    IntStatus oldLevel;
+
+    if (ReadCached(slot, data)) {
+	oldLevel = interrupt->SetLevel(IntOff);	// as the handler would be
+	(*whenDone)(whenDoneArg);
+	(void) interrupt->SetLevel(oldLevel);
+    } else
+	Queue(slot, 1, &data, FALSE, whenDone, whenDoneArg);
+}
+
+//----------------------------------------------------------------------
+// SwapDevice::StartWrite
+// 	Start writing a page into a slot, and return at once.  The disk
+//	takes its copy of the data when it gets to the request, so the
+//	page must not be reused until "whenDone" is called.
+//
+//	"slot" -- the slot to write
+//	"data" -- the page, PageSize bytes
+//	"whenDone", "whenDoneArg" -- what to call when it is written
+//----------------------------------------------------------------------
+
+void
+SwapDevice::StartWrite(int slot, char *data, VoidFunctionPtr whenDone,
+		       int whenDoneArg)
+{
+    IntStatus oldLevel;
+
+    if (WriteCached(slot, data)) {
+	oldLevel = interrupt->SetLevel(IntOff);	// as the handler would be
+	(*whenDone)(whenDoneArg);
+	(void) interrupt->SetLevel(oldLevel);
+    } else
+	Queue(slot, 1, &data, TRUE, whenDone, whenDoneArg);
+}
+
+//----------------------------------------------------------------------
+// SwapDevice::ReadCached
+// 	Read a page from the cache, if it is there.
+//
+//	"slot" -- the slot to read
+//	"data" -- where the page goes
+//
+// Returns:
+//	Whether it was there; if not, the disk must be read.
+//----------------------------------------------------------------------
+
+bool
+SwapDevice::ReadCached(int slot, char *data)
+{
+    IntStatus oldLevel;
+    bool hit;
+
+    if (cache == NULL)
+	return FALSE;
+    oldLevel = interrupt->SetLevel(IntOff);
+    hit = cache->Load(slot, data);
+    if (hit)
+	stats->numSwapCacheHits++;
+    else
+	stats->numSwapCacheMisses++;
+    (void) interrupt->SetLevel(oldLevel);
+    return hit;
+}
+
+//----------------------------------------------------------------------
+// SwapDevice::WriteCached
+// 	Write a page to the cache instead of the disk, if it compresses,
+//	writing the coldest pages in the cache back to the disk to make
+//	room.  If it does not compress, whatever the cache held for the
+//	slot is out of date, and is dropped.
+//
+//	This is done with interrupts off, so that a thread switch cannot
+//	come between compressing the page and storing it.
+//
+//	"slot" -- the slot to write
+//	"data" -- the page
+//
+// Returns:
+//	Whether the cache took the page; if not, the disk must be written.
+//----------------------------------------------------------------------
+
+bool
+SwapDevice::WriteCached(int slot, char *data)
+{
+    IntStatus oldLevel;
+    int size;
+
+    if (cache == NULL)
+	return FALSE;
+    oldLevel = interrupt->SetLevel(IntOff);
+    cache->Drop(slot);
+    size = cache->Compress(data);
+    if (size == -1)
+	stats->numSwapCacheRejects++;
+    else {
+	while (!cache->Fits(size))
+	    WriteBack(cache->Coldest());
+	cache->Store(slot);
+	stats->numSwapCacheStores++;
+	stats->numSwapCacheBytesIn += PageSize;
+	stats->numSwapCacheBytesOut += size;
+    }
+    (void) interrupt->SetLevel(oldLevel);
+    return size != -1;
+}
+
+//----------------------------------------------------------------------
+// SwapDevice::WriteBack
+// 	Write the page the cache holds for a slot to the disk, and drop
+//	it from the cache.  The write is queued, so later reads of the
+//	slot will find the page on the disk.
+//
+//	Called with interrupts off.
+//
+//	"slot" -- the slot, whose page must be cached
+//----------------------------------------------------------------------
+
+void
+SwapDevice::WriteBack(int slot)
+{
+    char *page = new char[PageSize];
+    bool cached = cache->Load(slot, page);
+
+    ASSERT(cached);
+    cache->Drop(slot);
+    stats->numSwapCacheWriteBacks++;
+    Queue(slot, 1, &page, TRUE, WriteBackDone, (int) page);
+}
+
+//----------------------------------------------------------------------
+// SwapDevice::Transfer
+// 	Read or write pages, waiting until the interrupt handler says
+//	they have all been transferred.
+//
+//	"slot" -- the first slot
+//	"count" -- how many pages, in consecutive slots
+//	"pages" -- the pages
+//	"writing" -- write the pages, rather than read them
+//----------------------------------------------------------------------
+
+void
+SwapDevice::Transfer(int slot, int count, char **pages, bool writing)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    Queue(slot, count, pages, writing, WakeUp, (int) currentThread);
+    currentThread->Sleep();		// until the request is done
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// SwapDevice::Queue
+// 	Put a request on the queue, and start the disk on it if it is
+//	idle.
+//
+//	"slot" -- the first slot
+//	"count" -- how many pages, in consecutive slots
+//	"pages" -- the pages; the list is copied, so it need not be kept
+//	"writing" -- write the pages, rather than read them
+//	"whenDone", "whenDoneArg" -- what to call when it is done
+//----------------------------------------------------------------------
+
+void
+SwapDevice::Queue(int slot, int count, char **pages, bool writing,
+		  VoidFunctionPtr whenDone, int whenDoneArg)
+{
+    SwapRequest *request = new SwapRequest;
+    IntStatus oldLevel;
+
+    ASSERT(count > 0 && slot >= 0 && slot + count <= numSlots);
+    request->sector = slot * SectorsPerSlot;
+    request->sectorsDone = 0;
+    request->sectorsLeft = count * SectorsPerSlot;
+    request->pages = new char *[count];
+    for (int i = 0; i < count; i++)
+	request->pages[i] = pages[i];
+    request->writing = writing;
+    request->whenDone = whenDone;
+    request->whenDoneArg = whenDoneArg;
+
+    oldLevel = interrupt->SetLevel(IntOff);
+    queue->Append((void *) request);
+    if (current == NULL)
+	StartNext();
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// SwapDevice::StartNext
+// 	Give the disk its next sector: the rest of the current request,
+//	or else the first sector of the next one on the queue.
+//
+//	Called with interrupts off.
+//----------------------------------------------------------------------
+
+void
+SwapDevice::StartNext()
+{
+    char *data;
+
+    if (current == NULL || current->sectorsLeft == 0)
+	current = (SwapRequest *) queue->Remove();
+    if (current == NULL)
+	return;				// the disk is idle
+    data = current->pages[current->sectorsDone / SectorsPerSlot]
+	+ (current->sectorsDone % SectorsPerSlot) * SectorSize;
+    if (current->writing)
+	disk->WriteRequest(current->sector, data);
+    else
+	disk->ReadRequest(current->sector, data);
+    current->sector++;
+    current->sectorsDone++;
+    current->sectorsLeft--;
+}
+
+//----------------------------------------------------------------------
+// SwapDevice::RequestDone
+// 	Swap disk interrupt handler.  A sector has been transferred; if
+//	it was the last of its request, the request is done.  Then start
+//	the disk on the next sector.
+//----------------------------------------------------------------------
+
+void
+SwapDevice::RequestDone()
+{
+    ASSERT(current != NULL);
+    if (current->sectorsLeft == 0) {
+	(*current->whenDone)(current->whenDoneArg);
+	delete [] current->pages;
+	delete current;
+	current = NULL;
+    }
+    StartNext();
+}
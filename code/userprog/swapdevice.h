@@ -0,0 +1,116 @@
+// swapdevice.h
+//	Data structures for the swap device: the backing store that
+//	evicted pages are written to, shared by every address space.
+//
+//	The swap device is a raw disk of its own (simulated in the UNIX
+//	file "SWAP"), divided into slots of one page each.  A bitmap
+//	records which slots hold someone's page.  An address space is
+//	given a slot for one of its pages only when the page is evicted
+//	dirty, and keeps it until it goes away.
+//
+//	A slot may be shared by several pages holding the same data: a
+//	page of a process and of its copy made by Fork, or the pages that
+//	were sharing a frame when it was evicted.  Each slot counts the
+//	pages using it, and is only free when the last one gives it back.
+//	A shared slot is never written: a page that is changed gets a
+//	slot of its own (see AddrSpace::SwapSlot).
+//
+//	ReadSlot and WriteSlot are synchronous: the thread making the
+//	request waits for the disk, and other threads run in the meantime.
+//	StartRead and StartWrite just queue the request, and call a
+//	function when it is done, so that several can be outstanding.
+//	Requests are carried out strictly in the order they are made, so
+//	a page read from a slot always sees the last write to it.
+//
+//	WriteSlots writes several pages to consecutive slots (found with
+//	AllocateSlots) as one request.  The disk is given each sector as
+//	soon as the one before it is done, so the seek and rotational
+//	delay are paid once for the lot, rather than once per page.
+//
+//	The disk may have a cache of compressed pages in front of it (see
+//	swapcache.h).  A read or write the cache can take is done at once,
+//	without the disk; "whenDone" is then called before StartRead or
+//	StartWrite returns.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SWAPDEVICE_H
+#define SWAPDEVICE_H
+
+#include "copyright.h"
+#include "disk.h"
+#include "list.h"
+#include "bitmap.h"
+#include "swapcache.h"
+
+// A read or write waiting for the swap disk, or being done by it.
+
+class SwapRequest {
+  public:
+    int sector;				// the next sector to transfer
+    int sectorsDone;			// how many have been transferred
+    int sectorsLeft;			// and how many there are still to go
+    char **pages;			// where each page's data is
+    bool writing;
+    VoidFunctionPtr whenDone;		// called (by the interrupt handler)
+    int whenDoneArg;			// when the request is done
+};
+
+class SwapDevice {
+  public:
+    SwapDevice(char *name, int cacheSize);
+					// open (or create) the swap disk,
+					// with every slot free, and a cache
+					// of "cacheSize" bytes (or none)
+    ~SwapDevice();
+
+    int AllocateSlot();			// a free slot, or -1 if there is none
+    int AllocateSlots(int count);	// the first of "count" consecutive
+					// free slots, or -1
+    void ShareSlot(int slot);		// one more page is using a slot
+    bool IsShared(int slot) { return users[slot] > 1; }
+    void FreeSlot(int slot);		// give a slot back
+
+    void ReadSlot(int slot, char *data);
+    					// Read/write a page, returning once
+    					// the disk has finished
+    void WriteSlot(int slot, char *data);
+    void WriteSlots(int slot, int count, char **pages);
+					// write pages to consecutive slots
+    void StartRead(int slot, char *data, VoidFunctionPtr whenDone,
+		   int whenDoneArg);	// Read/write a page, calling
+					// (*whenDone)(whenDoneArg) once the
+					// disk has finished
+    void StartWrite(int slot, char *data, VoidFunctionPtr whenDone,
+		    int whenDoneArg);
+
+    bool Busy() { return current != NULL; }
+					// a thread is waiting for the disk
+    void RequestDone();			// called by the disk interrupt handler
+
+  private:
+    Disk *disk;				// the raw swap disk
+    BitMap *slots;			// which slots are in use
+    int *users;				// how many pages are using each
+    int numSlots;
+    SwapRequest *current;		// the request the disk is doing
+    List *queue;			// requests waiting for it to finish
+    SwapCache *cache;			// compressed pages, or NULL
+
+    bool ReadCached(int slot, char *data);
+					// read a page from the cache, if
+					// it is there
+    bool WriteCached(int slot, char *data);
+					// write a page to the cache, if it
+					// will go; if not, drop the old one
+    void WriteBack(int slot);		// move a page from the cache to disk
+
+    void Transfer(int slot, int count, char **pages, bool writing);
+    void Queue(int slot, int count, char **pages, bool writing,
+	       VoidFunctionPtr whenDone, int whenDoneArg);
+    void StartNext();			// give the disk its next sector
+};
+
+#endif // SWAPDEVICE_H
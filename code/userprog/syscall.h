@@ -110,14 +110,17 @@ void Close(OpenFileId id);
 
 
 
-/* User-level thread operations: Fork and Yield.  To allow multiple
- * threads to run within a user program. 
+/* User-level process operations: Fork and Yield. */
+
+/* Start a new process running in a copy of the current address space.
+ * Nothing is copied until one of the two processes writes to it: until
+ * then, they share its pages.  The new process starts at "func", with a
+ * copy of the current one's registers and stack; if "func" returns,
+ * the new process goes on from where Fork was called.  If "func" is 0,
+ * the new process just returns from Fork, with 0, as in UNIX.
+ * Return the SpaceId of the new process, for Join.
  */
-
-/* Fork a thread to run a procedure ("func") in the *same* address space 
- * as the current thread.
- */
-void Fork(void (*func)());
+SpaceId Fork(void (*func)());
 
 /* Yield the CPU to another runnable thread, whether in this address space 
  * or not. 